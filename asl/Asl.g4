@@ -28,6 +28,16 @@
 
 grammar Asl;
 
+// All the contexts derive from AslRuleContext, that holds the number
+// of the node used by the TreeDecoration
+options {
+  contextSuperClass = AslRuleContext;
+}
+
+@parser::header {
+#include "../common/AslRuleContext.h"
+}
+
 //////////////////////////////////////////////////
 /// Parser Rules
 //////////////////////////////////////////////////
@@ -41,6 +51,17 @@ function
         : FUNC ID '(' parameters ')' (':' basic_type)? declarations statements ENDFUNC
         ;
 
+// The streaming mode (--stream) handles the functions one at a time:
+// it first reads the signature of every function, and then parses
+// each function as a whole input
+signature
+        : FUNC ID '(' parameters ')' (':' basic_type)?
+        ;
+
+single_function
+        : function EOF
+        ;
+
 parameters
         : (parameter (',' parameter)*)?
         ;
@@ -0,0 +1,138 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    Batch - Compilation of several Asl source files using a pool
+//            of threads (asl -j N file1.asl file2.asl ...)
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "Batch.h"
+#include "Driver.h"
+
+#include "antlr4-runtime.h"
+#include "../common/MappedCharStream.h"
+
+#include <iostream>
+#include <fstream>    // ofstream
+#include <sstream>
+#include <atomic>
+#include <thread>
+#include <algorithm>  // min
+#include <map>
+#include <cstdio>     // remove
+#include <cstdlib>    // EXIT_FAILURE, EXIT_SUCCESS
+
+// using namespace std;
+
+
+namespace {
+
+// Outcome of the compilation of one file of the batch
+struct BatchResult {
+  int         status = EXIT_FAILURE;
+  std::string diags;
+  std::string errs;
+};
+
+BatchResult compileFile(const std::string & filename, const CompilerOptions & options) {
+  BatchResult result;
+  MappedCharStream input;
+  if (not input.open(filename)) {
+    result.diags = "Could not open file: " + filename + "\n";
+    return result;
+  }
+
+  // the LLVM IR is streamed to its file
+  std::string llvmFileName = outputFileName(filename, ".ll");
+  std::ofstream llvmFile;
+  if (options.doLLVM)
+    llvmFile.open(llvmFileName, std::ofstream::out);
+
+  std::ostringstream tcode, diags, errs;
+  result.status = compile(input, options, tcode, diags, errs,
+                          options.doLLVM ? &llvmFile : nullptr);
+  result.diags = diags.str();
+  result.errs  = errs.str();
+
+  if (tcode.tellp() > 0) {
+    std::ofstream tFile(outputFileName(filename, ".t"), std::ofstream::out);
+    tFile << tcode.rdbuf();
+  }
+  if (options.doLLVM) {
+    // keep the .ll file only if the whole IR has been written
+    bool llvmDone = result.status == EXIT_SUCCESS and llvmFile.tellp() > 0;
+    if (llvmDone) llvmFile << std::endl;
+    llvmFile.close();
+    if (not llvmDone) std::remove(llvmFileName.c_str());
+  }
+  return result;
+}
+
+}  // namespace
+
+
+int compileFiles(const std::vector<std::string> & filenames,
+                 const CompilerOptions & options,
+                 unsigned int jobs) {
+  // the outputs are named after the basename of the sources, so two
+  // files with the same basename would write (concurrently) the same
+  // .t/.ll file: the batch is rejected before compiling anything
+  std::map<std::string, std::string> outputs;
+  for (auto & filename : filenames) {
+    auto ins = outputs.emplace(outputFileName(filename, ".t"), filename);
+    if (not ins.second) {
+      std::cout << "Files " << ins.first->second << " and " << filename
+                << " would both be written to " << ins.first->first << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<BatchResult> results(filenames.size());
+
+  // each worker takes the next file not yet compiled
+  std::atomic<std::size_t> next(0);
+  auto worker = [&]() {
+    for (std::size_t i = next++; i < filenames.size(); i = next++)
+      results[i] = compileFile(filenames[i], options);
+  };
+  jobs = std::max(1u, std::min<unsigned int>(jobs, filenames.size()));
+  std::vector<std::thread> pool;
+  for (unsigned int j = 1; j < jobs; ++j)
+    pool.emplace_back(worker);
+  worker();
+  for (auto & t : pool)
+    t.join();
+
+  int status = EXIT_SUCCESS;
+  for (std::size_t i = 0; i < filenames.size(); ++i) {
+    const BatchResult & result = results[i];
+    if (not result.diags.empty() or not result.errs.empty()) {
+      std::cout << filenames[i] << ":" << std::endl << result.diags << std::flush;
+      std::cerr << result.errs << std::flush;
+    }
+    if (result.status != EXIT_SUCCESS)
+      status = EXIT_FAILURE;
+  }
+  return status;
+}
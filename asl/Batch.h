@@ -0,0 +1,53 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    Batch - Compilation of several Asl source files using a pool
+//            of threads (asl -j N file1.asl file2.asl ...)
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Driver.h"
+
+#include <string>
+#include <vector>
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Batch mode: compile every file in filenames using up to jobs
+// threads. For each source file <dir>/<name>.asl the t-code is written
+// to <name>.t (and the LLVM IR to <name>.ll if options.doLLVM is set)
+// in the current directory, with the same contents a single run of
+// the compiler would produce. The messages of each file are written
+// to std::cout/std::cerr, preceded by the file name, in the same
+// order than the files were given. If two files have the same <name>
+// nothing is compiled, since their outputs would overwrite each other.
+// Returns EXIT_SUCCESS if all the files were compiled successfully.
+
+int compileFiles(const std::vector<std::string> & filenames,
+                 const CompilerOptions & options,
+                 unsigned int jobs);
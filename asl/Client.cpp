@@ -0,0 +1,137 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    Client - Send a compilation to the resident server
+//             of the Asl compiler, whose caches are warm
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "Client.h"
+#include "Driver.h"
+#include "FdStreamBuf.h"
+
+#include <iostream>
+#include <fstream>    // ofstream
+#include <cstdlib>    // free
+
+#include <climits>    // realpath
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// using namespace std;
+
+
+namespace {
+
+// Connect to the Unix socket socketPath. Returns the descriptor of
+// the connection, or -1
+int connectTo(const std::string & socketPath) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(addr.sun_path))
+    return -1;
+  socketPath.copy(addr.sun_path, socketPath.size());
+  int conn = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (conn < 0)
+    return -1;
+  if (::connect(conn, (sockaddr *) &addr, sizeof(addr)) < 0) {
+    ::close(conn);
+    return -1;
+  }
+  return conn;
+}
+
+// Read one section of the answer (see writeSection in Server.cpp)
+bool readSection(std::istream & in, const std::string & name, std::string & text) {
+  std::string word;
+  std::size_t nbytes;
+  if (not (in >> word >> nbytes) or word != name or in.get() != '\n')
+    return false;
+  text.assign(nbytes, '\0');
+  in.read(&text[0], nbytes);
+  return std::size_t(in.gcount()) == nbytes;
+}
+
+}  // namespace
+
+
+int compileOnServer(const std::string & socketPath,
+                    const std::vector<std::string> & options,
+                    const std::string & filename,
+                    const std::string & source,
+                    bool genLLVM) {
+  // the server runs in another directory: it gets the absolute path
+  std::string path;
+  if (filename != "") {
+    char *absolute = ::realpath(filename.c_str(), nullptr);
+    if (absolute == nullptr)
+      return NoServer;
+    path = absolute;
+    std::free(absolute);
+  }
+
+  int conn = connectTo(socketPath);
+  if (conn < 0)
+    return NoServer;
+
+  int status = NoServer;
+  std::string tcode, llvm, diags, errs;
+  {
+    FdStreamBuf buf(conn);
+    std::istream in(&buf);
+    std::ostream out(&buf);
+    out << (path != "" ? "compile" : "inline");
+    for (auto & option : options)
+      out << " " << option;
+    if (path != "")
+      out << " " << path << "\n";
+    else
+      out << " " << source.size() << "\n" << source;
+    out << "quit" << std::endl;
+
+    std::string word, end;
+    bool complete = (in >> word >> status) and word == "status" and
+                    in.get() == '\n' and
+                    readSection(in, "tcode", tcode) and
+                    readSection(in, "llvm", llvm) and
+                    readSection(in, "diagnostics", diags) and
+                    readSection(in, "errs", errs) and
+                    (in >> end) and end == "end";
+    if (not complete)
+      status = NoServer;
+  }
+  ::close(conn);
+  if (status == NoServer)
+    return NoServer;
+
+  std::cout << tcode << diags << std::flush;
+  std::cerr << errs << std::flush;
+  // the server sends the IR only if the whole program was translated
+  if (genLLVM and llvm != "") {
+    std::ofstream llvmFile(outputFileName(filename, ".ll"), std::ofstream::out);
+    llvmFile << llvm << std::endl;
+  }
+  return status;
+}
@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    Client - Send a compilation to the resident server
+//             of the Asl compiler, whose caches are warm
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Client mode (asl --client=<socket path> [<options>] [<file.asl>]).
+// The compilation is sent to a server started with
+// --server=<socket path>, whose lexer and parser DFA caches are
+// already warm, so a short-lived asl process does not have to learn
+// again the prediction decisions of the grammar. The t-code and the
+// messages are written to std::cout, the syntax errors to std::cerr
+// and the LLVM IR to the .ll file, as in a single run. --parseStats
+// is rejected with --client (the counters of the server are shared by
+// all its requests).
+//   - options are the command line options of the compilation
+//   - filename is the source file; if it is empty, source is sent
+//     instead (the text read from std::cin)
+// Returns the exit status of the compilation, or NoServer if the
+// server could not be reached or its answer was not complete. In that
+// case nothing has been written, and the caller can compile the
+// program by itself.
+
+const int NoServer = -1;
+
+int compileOnServer(const std::string & socketPath,
+                    const std::vector<std::string> & options,
+                    const std::string & filename,
+                    const std::string & source,
+                    bool genLLVM);
@@ -35,9 +35,15 @@
 #include "../common/TypesMgr.h"
 #include "../common/code.h"
 
+#include "TreeLowering.h"
+#include "StackThread.h"
+
+#include <algorithm> // min, max
+#include <atomic>
 #include <cassert>
 #include <cstddef> // std::size_t
 #include <string>
+#include <list>
 #include <vector>
 
 // uncomment the following line to enable debugging messages with DEBUG*
@@ -49,8 +55,17 @@
 
 // Constructor
 CodeGenVisitor::CodeGenVisitor(TypesMgr &Types, SymTable &Symbols,
-                               TreeDecoration &Decorations)
-    : Types{Types}, Symbols{Symbols}, Decorations{Decorations} {}
+                               TreeDecoration &Decorations,
+                               const TreeLowering &Lowered, unsigned int jobs,
+                               std::size_t stackSize)
+    : Types{Types}, Symbols{Symbols}, Decorations{Decorations},
+      Lowered{Lowered}, numJobs{std::max(1u, jobs)}, stackSize{stackSize} {}
+
+subroutine CodeGenVisitor::translateFunction(AslParser::FunctionContext *ctx,
+                                             SymTable::ScopeId globalScope) {
+    currScope = globalScope;
+    return visitAs<subroutine>(ctx);
+}
 
 // Accessor/Mutator to the attribute currFunctionType
 TypesMgr::TypeId CodeGenVisitor::getCurrentFunctionTy() const {
@@ -61,34 +76,45 @@ void CodeGenVisitor::setCurrentFunctionTy(TypesMgr::TypeId type) {
     currFunctionType = type;
 }
 
-std::string CodeGenVisitor::newTemp() {
-    return "%" + codeCounters.newTEMP();
+// The std::any returned by visit is a temporary, so the result is
+// moved out of it instead of copied
+template <typename T>
+T CodeGenVisitor::visitAs(antlr4::tree::ParseTree *ctx) {
+    return std::any_cast<T>(visit(ctx));
+}
+
+operand CodeGenVisitor::newTemp() {
+    return codeCounters.newTEMP();
+}
+
+operand CodeGenVisitor::nameOperand(const std::string &name) {
+    return currSpellings->name(name);
 }
 
 instructionList CodeGenVisitor::inst(Assign assign) {
     instructionList code;
 
-    std::string src = assign.src;
-    std::string dst = assign.dst;
+    operand src = assign.src;
+    operand dst = assign.dst;
 
-    std::string dstOffset = assign.dstOffset;
-    if (dstOffset != "")
+    operand dstOffset = assign.dstOffset;
+    if (not dstOffset.empty())
     {
         dstOffset = newTemp();
-        code = code || instruction::LOAD(dstOffset, assign.dstOffset);
+        code += instruction::LOAD(dstOffset, assign.dstOffset);
     }
 
-    if (assign.srcOffset != "") {
-        CodeAttribs&& srcElement = inst_load(assign.src, assign.srcOffset);
-        code = code || srcElement.code;
+    if (not assign.srcOffset.empty()) {
+        CodeAttribs&& srcElement = inst_load(assign.src, assign.srcReference, assign.srcOffset);
+        code += srcElement.code;
         src = srcElement.addr;
     }
 
     // Handle array by reference
-    if (dstOffset != "") {
-        if (Symbols.isParameterClass(dst)) {
-            std::string arrayAddr = newTemp();
-            code = code || instruction::LOAD(arrayAddr, dst);
+    if (not dstOffset.empty()) {
+        if (assign.dstReference) {
+            operand arrayAddr = newTemp();
+            code += instruction::LOAD(arrayAddr, dst);
             dst = arrayAddr;
         }
     }
@@ -96,15 +122,15 @@ instructionList CodeGenVisitor::inst(Assign assign) {
     // Float -> Int conversion
     if (Types.isIntegerTy(assign.srcType) && Types.isFloatTy(assign.dstType))
     {
-        std::string temp = newTemp();
-        code = code || instruction::FLOAT(temp, src);
+        operand temp = newTemp();
+        code += instruction::FLOAT(temp, src);
         src = temp;
     }
 
-    if (dstOffset != "") // a[i] = x
-        code = code || instruction::XLOAD(dst, dstOffset, src);
+    if (not dstOffset.empty()) // a[i] = x
+        code += instruction::XLOAD(dst, dstOffset, src);
     else  // x = y // x = a[i]
-        code = code || instruction::LOAD(dst, src);
+        code += instruction::LOAD(dst, src);
 
     return code;
 }
@@ -113,35 +139,35 @@ instructionList CodeGenVisitor::inst(ForRange inst_for) {
     instructionList code;
 
     // For loop condition: i < end
-    std::string condVar = newTemp();
+    operand condVar = newTemp();
 
     // define start & end
-    std::string increment = newTemp();
-    code = code || instruction::ILOAD(increment, inst_for.increment);
-    std::string end = newTemp();
-    code = code || instruction::ILOAD(end, inst_for.end);
+    operand increment = newTemp();
+    code += instruction::ILOAD(increment, inst_for.increment);
+    operand end = newTemp();
+    code += instruction::ILOAD(end, inst_for.end);
 
     // i = start;
-    code = code || instruction::ILOAD(inst_for.index, inst_for.start);
+    code += instruction::ILOAD(inst_for.index, inst_for.start);
 
     // i < end
     instructionList condCode = instruction::LT(condVar, inst_for.index, end);
-    CodeAttribs cond(condVar, "", condCode);
+    CodeAttribs cond(condVar, operand(), condCode);
 
     // while (i < end) { inst_for.body; ++i }
-    code = code || inst(While {
+    code += inst(While {
         .cond = cond,
-        .body = inst_for.body || instruction::ADD(inst_for.index, inst_for.index, increment)
+        .body = std::move(inst_for.body) || instruction::ADD(inst_for.index, inst_for.index, increment)
     });
 
     return code;
 }
 
 instructionList CodeGenVisitor::inst(While inst_while) {
-    std::string label = codeCounters.newLabelWHILE();
+    unsigned int label = codeCounters.newLabelWHILE();
 
-    std::string labelEndWhile = "endwhile" + label;
-    std::string labelStartWhile = "while" + label;
+    operand labelEndWhile = operand::label(operand::ENDWHILE, label);
+    operand labelStartWhile = operand::label(operand::WHILE, label);
 
     // while:
     //      code...
@@ -149,15 +175,15 @@ instructionList CodeGenVisitor::inst(While inst_while) {
     //      jump while
     // endwhile:
     return instruction::LABEL(labelStartWhile) || inst_while.cond.code ||
-           instruction::FJUMP(inst_while.cond.addr, labelEndWhile) || inst_while.body ||
+           instruction::FJUMP(inst_while.cond.addr, labelEndWhile) || std::move(inst_while.body) ||
            instruction::UJUMP(labelStartWhile) ||
            instruction::LABEL(labelEndWhile);
 }
 
 instructionList CodeGenVisitor::inst(If inst_if) {
-    std::string label_id = codeCounters.newLabelIF();
-    std::string exitLabel = "exit_if_" + label_id;
-    std::string falseLabel = "else_if_" + label_id;
+    unsigned int label_id = codeCounters.newLabelIF();
+    operand exitLabel = operand::label(operand::EXIT_IF, label_id);
+    operand falseLabel = operand::label(operand::ELSE_IF, label_id);
 
     //  ifFalse condition => jump false_label
     //      true_body
@@ -166,74 +192,76 @@ instructionList CodeGenVisitor::inst(If inst_if) {
     //      else_body
     //  exit_label:
     return instruction::FJUMP(inst_if.condition, falseLabel)
-        || inst_if.trueBody || instruction::UJUMP(exitLabel) ||
-        instruction::LABEL(falseLabel) || inst_if.falseBody ||
+        || std::move(inst_if.trueBody) || instruction::UJUMP(exitLabel) ||
+        instruction::LABEL(falseLabel) || std::move(inst_if.falseBody) ||
         instruction::LABEL(exitLabel);
 }
 
 instructionList CodeGenVisitor::inst(FuncCall inst_call) {
     instructionList code;
 
-    code = code || instruction::PUSH(); // for saving the result
+    code += instruction::PUSH(); // for saving the result
 
     for (size_t i = 0; i < inst_call.arguments.size(); ++i) {
         const CodeAttribs &param = inst_call.arguments[i];
         TypesMgr::TypeId paramType = inst_call.argumentsTypes[i];
 
-        std::string value = newTemp();
+        operand value = newTemp();
         
-        code = code || param.code;
+        code += param.code;
 
         if (Types.isArrayTy(paramType)) {
-            if (Symbols.isParameterClass(param.addr)) {
+            if (param.reference) {
                 value = param.addr;
             } else {
-                code = code || instruction::ALOAD(value, param.addr);
+                code += instruction::ALOAD(value, param.addr);
             }
         } else {
-            code = code || inst(Assign {
+            code += inst(Assign {
                 .dstType = Types.getParameterType(inst_call.functionType, i),
                 .dst = value,
-.dstOffset = "",
+                .dstOffset = operand(),
                 .srcType = paramType,
                 .src = param.addr,
                 .srcOffset = param.offs,
+                .srcReference = param.reference,
             });
         }
-        code = code || instruction::PUSH(value);
+        code += instruction::PUSH(value);
     }
 
-    code = code || instruction::CALL(inst_call.functionName);
+    code += instruction::CALL(inst_call.functionName);
 
     for (size_t i = 0; i < inst_call.arguments.size(); ++i) {
-        code = code || instruction::POP();
+        code += instruction::POP();
     }
 
-    code = code || instruction::POP(inst_call.result);
+    code += instruction::POP(inst_call.result);
 
     return code;
 }
 
-CodeGenVisitor::CodeAttribs CodeGenVisitor::inst_load(const std::string& addr, const std::string& offset) {
-    CodeAttribs codAts(addr, "", {});
+CodeGenVisitor::CodeAttribs CodeGenVisitor::inst_load(const operand& addr, bool reference,
+                                                      const operand& offset) {
+    CodeAttribs codAts(addr, operand(), {});
 
     // Handle array by reference
-    if (Symbols.isParameterClass(addr) && Types.isArrayTy(Symbols.getType(addr))) {
-        std::string arrayAddr = newTemp();
+    if (reference) {
+        operand arrayAddr = newTemp();
         // temp = addr
-        codAts.code = codAts.code || instruction::LOAD(arrayAddr, addr);
+        codAts.code += instruction::LOAD(arrayAddr, addr);
         codAts.addr = arrayAddr;
     }
 
-    if (offset == "") {
+    if (offset.empty()) {
         return codAts;
     } else {
         // Handle array with offset
-        std::string temp = newTemp();
-        std::string offsetTemp = newTemp();
-        codAts.code = codAts.code || instruction::LOAD(offsetTemp, offset);
+        operand temp = newTemp();
+        operand offsetTemp = newTemp();
+        codAts.code += instruction::LOAD(offsetTemp, offset);
         // temp = code.addr[offsetTemp]
-        codAts.code = codAts.code || instruction::LOADX(temp, codAts.addr, offsetTemp);
+        codAts.code += instruction::LOADX(temp, codAts.addr, offsetTemp);
         codAts.addr = temp;
         return codAts;
     }
@@ -244,22 +272,45 @@ CodeGenVisitor::CodeAttribs CodeGenVisitor::inst_load(const std::string& addr, c
 std::any CodeGenVisitor::visitProgram(AslParser::ProgramContext *ctx) {
     DEBUG_ENTER();
     code my_code;
-    SymTable::ScopeId sc = getScopeDecor(ctx);
-    Symbols.pushThisScope(sc);
-    for (auto ctxFunc : ctx->function()) {
-        subroutine subr = std::any_cast<subroutine>(visit(ctxFunc));
-        my_code.add_subroutine(subr);
+    currScope = getScopeDecor(ctx);
+    std::vector<AslParser::FunctionContext *> functions = ctx->function();
+    std::vector<std::any> subrs(functions.size());
+
+    // Each function only reads the symbol table and the decorations,
+    // so they can be translated by several workers, each one with its
+    // own CodeGenVisitor (and counters)
+    std::atomic<std::size_t> next(0);
+    auto worker = [&](CodeGenVisitor &gen) {
+        for (std::size_t i = next++; i < functions.size(); i = next++)
+            subrs[i] = gen.visit(functions[i]);
+    };
+    unsigned int jobs = std::min<std::size_t>(numJobs, functions.size());
+    std::vector<CodeGenVisitor> workers;
+    workers.reserve(jobs);
+    std::list<StackThread> pool;
+    for (unsigned int j = 1; j < jobs; ++j) {
+        workers.emplace_back(Types, Symbols, Decorations, Lowered);
+        workers.back().currScope = currScope;
+        CodeGenVisitor &gen = workers.back();
+        pool.emplace_back(stackSize, [&worker, &gen]() { worker(gen); });
     }
-    Symbols.popScope();
+    worker(*this);
+    for (auto &t : pool)
+        t.join();
+
+    // assemble the subroutines in source order
+    for (auto &subr : subrs)
+        my_code.add_subroutine(std::any_cast<subroutine>(std::move(subr)));
     DEBUG_EXIT();
     return my_code;
 }
 
 std::any CodeGenVisitor::visitFunction(AslParser::FunctionContext *ctx) {
     DEBUG_ENTER();
-    SymTable::ScopeId sc = getScopeDecor(ctx);
-    Symbols.pushThisScope(sc);
+    SymTable::ScopeId globalScope = currScope;
+    currScope = getScopeDecor(ctx);
     subroutine subr(ctx->ID()->getText());
+    currSpellings = &subr.get_spellings();
     codeCounters.reset();
 
     TypesMgr::TypeId returnType = Types.createVoidTy();
@@ -270,13 +321,10 @@ std::any CodeGenVisitor::visitFunction(AslParser::FunctionContext *ctx) {
         subr.add_param("_result", Types.to_string(returnType));
     }
 
-    std::vector<TypesMgr::TypeId> paramsTypes;
-
     // Define Parameters
     for (auto *param : ctx->parameters()->parameter()) {
         std::string name = param->ID()->getText();
         TypesMgr::TypeId type = getTypeDecor(param->type());
-        paramsTypes.push_back(type);
 
         if (Types.isArrayTy(type)) {
             TypesMgr::TypeId elementType = Types.getArrayElemType(type);
@@ -286,26 +334,27 @@ std::any CodeGenVisitor::visitFunction(AslParser::FunctionContext *ctx) {
         }
     }
 
-    setCurrentFunctionTy(Types.createFunctionTy(paramsTypes, returnType));
+    setCurrentFunctionTy(Symbols.getType(globalScope, ctx->ID()->getText()));
 
 
     // Define Local Variables
-    std::vector<var> &&lvars =
-        std::any_cast<std::vector<var>>(visit(ctx->declarations()));
+    std::vector<var> lvars =
+        visitAs<std::vector<var>>(ctx->declarations());
     for (auto &onevar : lvars) {
         subr.add_var(onevar);
     }
 
     // Define Code
-    instructionList &&code =
-        std::any_cast<instructionList>(visit(ctx->statements()));
+    instructionList code =
+        visitAs<instructionList>(ctx->statements());
     
     // In case of void function
-    code = code || instruction(instruction::RETURN());
+    code += instruction(instruction::RETURN());
 
 
-    subr.set_instructions(code);
-    Symbols.popScope();
+    subr.set_instructions(std::move(code));
+    currSpellings = nullptr;
+    currScope = globalScope;
     DEBUG_EXIT();
     return subr;
 }
@@ -315,7 +364,7 @@ std::any CodeGenVisitor::visitDeclarations(AslParser::DeclarationsContext *ctx)
     std::vector<var> lvars;
     for (auto &varDeclCtx : ctx->variable_decl()) {
         std::vector<var> morevar =
-            std::any_cast<std::vector<var>>(visit(varDeclCtx));
+            visitAs<std::vector<var>>(varDeclCtx);
         lvars.insert(lvars.end(), morevar.begin(), morevar.end());
     }
     DEBUG_EXIT();
@@ -365,10 +414,13 @@ std::any CodeGenVisitor::visitStatements(AslParser::StatementsContext *ctx) {
     DEBUG_ENTER();
     instructionList code;
     for (auto stCtx : ctx->statement()) {
-        code = code || instruction::CHLOAD(";;;", stCtx->getText());
-
-        instructionList &&codeS = std::any_cast<instructionList>(visit(stCtx));
-        code = code || codeS;
+        // the position of the statement goes to the source ranges of
+        // the list, not to the code
+        std::size_t begin = code.size();
+        code += visitAs<instructionList>(stCtx);
+        antlr4::Token *start = stCtx->getStart();
+        code.set_source(begin, {uint32_t(start->getLine()),
+                                uint32_t(start->getCharPositionInLine())});
     }
     DEBUG_EXIT();
     return code;
@@ -378,60 +430,62 @@ std::any CodeGenVisitor::visitAssignStmt(AslParser::AssignStmtContext *ctx) {
     DEBUG_ENTER();
     instructionList code;
 
-    CodeAttribs &&codeAtsLhs =
-        std::any_cast<CodeAttribs>(visit(ctx->left_expr()));
-    std::string addrLhs = codeAtsLhs.addr;
-    std::string offsLhs = codeAtsLhs.offs;
+    CodeAttribs codeAtsLhs =
+        visitAs<CodeAttribs>(ctx->left_expr());
+    operand addrLhs = codeAtsLhs.addr;
+    operand offsLhs = codeAtsLhs.offs;
     instructionList &codeLhs = codeAtsLhs.code;
 
     TypesMgr::TypeId typeLhs = getTypeDecor(ctx->left_expr());
 
-    CodeAttribs &&codeAtsRhs = std::any_cast<CodeAttribs>(visit(ctx->expr()));
-    std::string addrRhs = codeAtsRhs.addr;
+    CodeAttribs codeAtsRhs = visitAs<CodeAttribs>(ctx->expr());
+    operand addrRhs = codeAtsRhs.addr;
     instructionList &codeRhs = codeAtsRhs.code;
-    std::string offsRhs = codeAtsRhs.offs;
 
     TypesMgr::TypeId typeRhs = getTypeDecor(ctx->expr());
 
-    code = code || codeLhs || codeRhs;
+    code += std::move(codeLhs);
+    code += std::move(codeRhs);
 
     if (Types.isArrayTy(typeLhs)) {
         TypesMgr::TypeId elemTypeLhs = Types.getArrayElemType(typeLhs);
         TypesMgr::TypeId elemTypeRhs = Types.getArrayElemType(typeRhs);
         size_t size = Types.getArraySize(typeLhs);
 
-        std::string index = newTemp();
+        operand index = newTemp();
 
         // value = src[i]
-        CodeAttribs value = inst_load(addrRhs, index);
-        instructionList body = value.code;
+        CodeAttribs value = inst_load(addrRhs, codeAtsRhs.reference, index);
+        instructionList body = std::move(value.code);
 
         // dst[i] = value
-        body = body || inst(Assign {
+        body += inst(Assign {
             .dstType = elemTypeLhs,
             .dst = addrLhs,
             .dstOffset = index,
+            .dstReference = codeAtsLhs.reference,
             .srcType = elemTypeRhs,
             .src = value.addr,
-            .srcOffset = "",
+            .srcOffset = operand(),
         });
         
         // for i in 0..size { dst[i] = src[i]; }
-        code = code || inst(ForRange {
-            .start = "0",
-            .end = std::to_string(size),
-            .increment = "1",
+        code += inst(ForRange {
+            .start = operand::integer(0),
+            .end = operand::integer(size),
+            .increment = operand::integer(1),
             .index=index,
-            .body = body,
+            .body = std::move(body),
         });
     } else {
-        code = code || inst(Assign {
+        code += inst(Assign {
             .dstType = typeLhs,
             .dst = addrLhs,
             .dstOffset = offsLhs,
+            .dstReference = codeAtsLhs.reference,
             .srcType = typeRhs,
             .src = addrRhs,
-            .srcOffset = "",
+            .srcOffset = operand(),
         });
     }
 
@@ -441,20 +495,20 @@ std::any CodeGenVisitor::visitAssignStmt(AslParser::AssignStmtContext *ctx) {
 
 std::any CodeGenVisitor::visitIfStmt(AslParser::IfStmtContext *ctx) {
     DEBUG_ENTER();
-    CodeAttribs &&condition = std::any_cast<CodeAttribs>(visit(ctx->expr()));
+    CodeAttribs condition = visitAs<CodeAttribs>(ctx->expr());
 
-    instructionList &&trueBody =
-        std::any_cast<instructionList>(visit(ctx->statements(0))); 
+    instructionList trueBody =
+        visitAs<instructionList>(ctx->statements(0)); 
 
     instructionList falseBody = {};
     if (ctx->statements(1))
-        falseBody = std::any_cast<instructionList>(visit(ctx->statements(1))); 
+        falseBody = visitAs<instructionList>(ctx->statements(1)); 
 
 
-    instructionList code = condition.code || inst(If {
+    instructionList code = std::move(condition.code) || inst(If {
         .condition = condition.addr,
-        .trueBody = trueBody,
-        .falseBody = falseBody,
+        .trueBody = std::move(trueBody),
+        .falseBody = std::move(falseBody),
     });
     DEBUG_EXIT();
     return code;
@@ -462,10 +516,10 @@ std::any CodeGenVisitor::visitIfStmt(AslParser::IfStmtContext *ctx) {
 
 std::any CodeGenVisitor::visitWhileStmt(AslParser::WhileStmtContext *ctx) {
     DEBUG_ENTER();
-    CodeAttribs &&cond = std::any_cast<CodeAttribs>(visit(ctx->expr()));
-    instructionList &&body = std::any_cast<instructionList>(visit(ctx->statements()));
+    CodeAttribs cond = visitAs<CodeAttribs>(ctx->expr());
+    instructionList body = visitAs<instructionList>(ctx->statements());
 
-    instructionList code = inst(While { cond, body});
+    instructionList code = inst(While { cond, std::move(body) });
 
     DEBUG_EXIT();
     return code;
@@ -474,44 +528,43 @@ std::any CodeGenVisitor::visitWhileStmt(AslParser::WhileStmtContext *ctx) {
 std::any CodeGenVisitor::visitProcCall(AslParser::ProcCallContext *ctx) {
     DEBUG_ENTER();
     instructionList code;
-    std::string name = ctx->ident()->getText();
-    // std::string name = ctx->ident()->ID()->getSymbol()->getText();
+    const std::string &name = Symbols.getName(Lowered.getAtom(ctx->ident()));
 
     if (!Types.isVoidFunction(getTypeDecor(ctx->ident())))
-        code = code || instruction::PUSH(); // for param result
+        code += instruction::PUSH(); // for param result
 
     for (size_t i = 0; i < ctx->expr().size(); ++i) {
-        CodeAttribs &&param = std::any_cast<CodeAttribs>(visit(ctx->expr(i)));
+        CodeAttribs param = visitAs<CodeAttribs>(ctx->expr(i));
 
-        code = code || param.code;
+        code += std::move(param.code);
         TypesMgr::TypeId paramType = Types.getParameterType(getTypeDecor(ctx->ident()), i);
         TypesMgr::TypeId valueType = getTypeDecor(ctx->expr(i));
 
         if (Types.isFloatTy(paramType) && Types.isIntegerTy(valueType))
         {
-            std::string temp = newTemp();
-            code = code || instruction::FLOAT(temp, param.addr);
+            operand temp = newTemp();
+            code += instruction::FLOAT(temp, param.addr);
             param.addr = temp;
         }
 
-        if (Types.isArrayTy(paramType) && !Symbols.isParameterClass(param.addr))
+        if (Types.isArrayTy(paramType) && !param.reference)
         {
-            std::string temp = newTemp();
-            code = code || instruction::ALOAD(temp, param.addr);
+            operand temp = newTemp();
+            code += instruction::ALOAD(temp, param.addr);
             param.addr = temp;
         }
 
-        code = code || instruction::PUSH(param.addr);
+        code += instruction::PUSH(param.addr);
     }
 
-    code = code || instruction::CALL(name);
+    code += instruction::CALL(nameOperand(name));
 
     for (size_t i = 0; i < ctx->expr().size(); ++i) {
-        code = code || instruction::POP();
+        code += instruction::POP();
     }
 
     if (!Types.isVoidFunction(getTypeDecor(ctx->ident())))
-        code = code || instruction::POP(); // for param result
+        code += instruction::POP(); // for param result
 
     DEBUG_EXIT();
     return code;
@@ -520,30 +573,30 @@ std::any CodeGenVisitor::visitProcCall(AslParser::ProcCallContext *ctx) {
 std::any CodeGenVisitor::visitReadStmt(AslParser::ReadStmtContext *ctx) {
     DEBUG_ENTER();
 
-    CodeAttribs &&codAtsDst = std::any_cast<CodeAttribs>(visit(ctx->left_expr()));
-    std::string addr1 = codAtsDst.addr;
-    std::string offs1 = codAtsDst.offs;
+    CodeAttribs codAtsDst = visitAs<CodeAttribs>(ctx->left_expr());
+    operand addr1 = codAtsDst.addr;
+    operand offs1 = codAtsDst.offs;
     TypesMgr::TypeId type = getTypeDecor(ctx->left_expr());
 
-    instructionList code = codAtsDst.code;
+    instructionList code = std::move(codAtsDst.code);
 
-    std::string input = newTemp();
+    operand input = newTemp();
     if (Types.isIntegerTy(type))
-        code = code || instruction::READI(input);
+        code += instruction::READI(input);
     else if (Types.isFloatTy(type))
-        code = code || instruction::READF(input);
+        code += instruction::READF(input);
     else if (Types.isCharacterTy(type))
-        code = code || instruction::READC(input);
+        code += instruction::READC(input);
     else if (Types.isBooleanTy(type))
-        code = code || instruction::READI(input);
+        code += instruction::READI(input);
 
-    code = code || inst(Assign {
+    code += inst(Assign {
         .dstType=type,
         .dst = addr1,
         .dstOffset = offs1,
         .srcType = type,
         .src = input,
-        .srcOffset = "",
+        .srcOffset = operand(),
     });
 
     DEBUG_EXIT();
@@ -552,31 +605,31 @@ std::any CodeGenVisitor::visitReadStmt(AslParser::ReadStmtContext *ctx) {
 
 std::any CodeGenVisitor::visitWriteExpr(AslParser::WriteExprContext *ctx) {
     DEBUG_ENTER();
-    CodeAttribs &&codAt1 = std::any_cast<CodeAttribs>(visit(ctx->expr()));
-    std::string addr1 = codAt1.addr;
+    CodeAttribs codAt1 = visitAs<CodeAttribs>(ctx->expr());
+    operand addr1 = codAt1.addr;
     // std::string         offs1 = codAt1.offs;
     instructionList &code1 = codAt1.code;
     instructionList &code = code1;
     TypesMgr::TypeId tid1 = getTypeDecor(ctx->expr());
 
     if (Types.isIntegerTy(tid1))
-        code = code1 || instruction::WRITEI(addr1);
+        code += instruction::WRITEI(addr1);
     else if (Types.isFloatTy(tid1))
-        code = code1 || instruction::WRITEF(addr1);
+        code += instruction::WRITEF(addr1);
     else if (Types.isCharacterTy(tid1))
-        code = code1 || instruction::WRITEC(addr1);
+        code += instruction::WRITEC(addr1);
     else if (Types.isBooleanTy(tid1))
-        code = code1 || instruction::WRITEI(addr1);
+        code += instruction::WRITEI(addr1);
 
     DEBUG_EXIT();
-    return code;
+    return std::move(code);
 }
 
 std::any CodeGenVisitor::visitWriteString(AslParser::WriteStringContext *ctx) {
     DEBUG_ENTER();
     instructionList code;
     std::string s = ctx->STRING()->getText();
-    code = code || instruction::WRITES(s);
+    code += instruction::WRITES(currSpellings->text(s));
     DEBUG_EXIT();
     return code;
 }
@@ -585,25 +638,25 @@ std::any CodeGenVisitor::visitReturn(AslParser::ReturnContext *ctx) {
     DEBUG_ENTER();
     instructionList code;
     if (ctx->expr()) {
-        CodeAttribs &&resultCode = std::any_cast<CodeAttribs>(visit(ctx->expr()));
-        code = code || resultCode.code || inst(Assign {
+        CodeAttribs resultCode = visitAs<CodeAttribs>(ctx->expr());
+        code += std::move(resultCode.code) || inst(Assign {
             .dstType = Types.getFuncReturnType(getCurrentFunctionTy()),
-            .dst = "_result",
-            .dstOffset = "",
+            .dst = nameOperand("_result"),
+            .dstOffset = operand(),
             .srcType = getTypeDecor(ctx->expr()),
             .src = resultCode.addr,
-            .srcOffset = "",
+            .srcOffset = operand(),
         });
     }
 
-    code = code || instruction::RETURN();
+    code += instruction::RETURN();
     DEBUG_EXIT();
     return code;
 }
 
 std::any CodeGenVisitor::visitSetIdent(AslParser::SetIdentContext *ctx) {
     DEBUG_ENTER();
-    CodeAttribs &&codAts = std::any_cast<CodeAttribs>(visit(ctx->ident()));
+    CodeAttribs codAts = visitAs<CodeAttribs>(ctx->ident());
     DEBUG_EXIT();
     return codAts;
 }
@@ -612,24 +665,25 @@ std::any CodeGenVisitor::visitSetArray(AslParser::SetArrayContext *ctx) {
     DEBUG_ENTER();
     instructionList code;
 
-    CodeAttribs &&codAts1 = std::any_cast<CodeAttribs>(visit(ctx->left_expr()));
-    std::string array = codAts1.addr;
+    CodeAttribs codAts1 = visitAs<CodeAttribs>(ctx->left_expr());
+    operand array = codAts1.addr;
     instructionList &code1 = codAts1.code;
 
     // Handle array by reference
-    if (Symbols.isParameterClass(array)) {
-        std::string arrayAddr = newTemp();
-        code = code || instruction::LOAD(arrayAddr, array);
+    if (codAts1.reference) {
+        operand arrayAddr = newTemp();
+        code += instruction::LOAD(arrayAddr, array);
         array = arrayAddr;
     }
     
-    CodeAttribs &&codAts2 = std::any_cast<CodeAttribs>(visit(ctx->expr()));
-    std::string index = codAts2.addr;
+    CodeAttribs codAts2 = visitAs<CodeAttribs>(ctx->expr());
+    operand index = codAts2.addr;
     instructionList &code2 = codAts2.code;
 
-    code = code || code1 || code2;
+    code += std::move(code1);
+    code += std::move(code2);
 
-    CodeAttribs codAts(array, index, code);
+    CodeAttribs codAts(array, index, std::move(code));
 
     DEBUG_EXIT();
     return codAts;
@@ -644,18 +698,19 @@ std::any CodeGenVisitor::visitSetArray(AslParser::SetArrayContext *ctx) {
 
 std::any CodeGenVisitor::visitParent(AslParser::ParentContext *ctx) {
     DEBUG_ENTER();
-    CodeAttribs &&codAts = std::any_cast<CodeAttribs>(visit(ctx->expr()));
+    CodeAttribs codAts = visitAs<CodeAttribs>(ctx->expr());
     DEBUG_EXIT();
     return codAts;
 }
 
 std::any CodeGenVisitor::visitGetArray(AslParser::GetArrayContext *ctx) {
     DEBUG_ENTER();
-    CodeAttribs &&arrayCode = std::any_cast<CodeAttribs>(visit(ctx->ident()));
-    CodeAttribs &&indexCode = std::any_cast<CodeAttribs>(visit(ctx->expr()));
+    CodeAttribs arrayCode = visitAs<CodeAttribs>(ctx->ident());
+    CodeAttribs indexCode = visitAs<CodeAttribs>(ctx->expr());
     
-    CodeAttribs arrayAccess = inst_load(arrayCode.addr, indexCode.addr);
-    arrayAccess.code = arrayCode.code || indexCode.code || arrayAccess.code;
+    CodeAttribs arrayAccess = inst_load(arrayCode.addr, arrayCode.reference, indexCode.addr);
+    arrayAccess.code = std::move(arrayCode.code) || std::move(indexCode.code) ||
+                       std::move(arrayAccess.code);
 
     DEBUG_EXIT();
     return arrayAccess;
@@ -666,16 +721,16 @@ std::any CodeGenVisitor::visitFuncCall(AslParser::FuncCallContext *ctx) {
 
     std::vector<CodeAttribs> arguments;
     std::vector<TypesMgr::TypeId> argumentsTypes;
-    std::string result = newTemp();
+    operand result = newTemp();
     
     for (size_t i = 0; i < ctx->expr().size(); ++i) {
-        arguments.push_back(std::any_cast<CodeAttribs>(visit(ctx->expr(i))));
+        arguments.push_back(visitAs<CodeAttribs>(ctx->expr(i)));
         argumentsTypes.push_back(getTypeDecor(ctx->expr(i)));
     }
 
-    CodeAttribs codAts(result, "", inst(FuncCall {
+    CodeAttribs codAts(result, operand(), inst(FuncCall {
         .functionType = getTypeDecor(ctx->ident()),
-        .functionName = ctx->ident()->getText(),
+        .functionName = nameOperand(Symbols.getName(Lowered.getAtom(ctx->ident()))),
         .arguments = arguments,
         .argumentsTypes = argumentsTypes,
         .result = result,
@@ -688,232 +743,294 @@ std::any CodeGenVisitor::visitFuncCall(AslParser::FuncCallContext *ctx) {
 
 std::any CodeGenVisitor::visitArithmetic(AslParser::ArithmeticContext *ctx) {
     DEBUG_ENTER();
-    CodeAttribs &&codAt1 = std::any_cast<CodeAttribs>(visit(ctx->expr(0)));
-    std::string lhs = codAt1.addr;
-    instructionList &code1 = codAt1.code;
+    CodeAttribs codAts = genBinaryChain(ctx);
+    DEBUG_EXIT();
+    return codAts;
+}
+
+// The left-recursive rules of expr give left-deep trees for the
+// chains of binary operators (a + b + c ...), that may be very long.
+// They are translated with an explicit stack: the chain is followed
+// down its left operands, and then the operators are translated
+// bottom-up, so only the right operands (and the expressions in
+// parenthesis) are visited recursively. The temporaries are created
+// in the same order as in a recursive translation
+CodeGenVisitor::CodeAttribs CodeGenVisitor::genBinaryChain(AslParser::ExprContext *ctx) {
+    std::vector<AslParser::ExprContext *> chain;
+    AslParser::ExprContext *node = ctx;
+    while (TreeLowering::isBinary(Lowered.getTag(node))) {
+        chain.push_back(node);
+        node = static_cast<AslParser::ExprContext *>(node->children[0]);
+    }
+
+    CodeAttribs result = visitAs<CodeAttribs>(node);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        node = *it;
+        CodeAttribs rhs = visitAs<CodeAttribs>(node->children[2]);
+        TreeLowering::Tag oper = Lowered.getTag(node);
+        if (TreeLowering::isArithmetic(oper))
+            result = genArithmetic(static_cast<AslParser::ArithmeticContext *>(node),
+                                   std::move(result), std::move(rhs));
+        else if (TreeLowering::isRelational(oper))
+            result = genRelational(static_cast<AslParser::RelationalContext *>(node),
+                                   std::move(result), std::move(rhs));
+        else
+            result = genLogical(static_cast<AslParser::LogicalContext *>(node),
+                                std::move(result), std::move(rhs));
+    }
+    return result;
+}
 
-    CodeAttribs &&codAt2 = std::any_cast<CodeAttribs>(visit(ctx->expr(1)));
+CodeGenVisitor::CodeAttribs CodeGenVisitor::genArithmetic(AslParser::ArithmeticContext *ctx,
+                                                          CodeAttribs codAt1,
+                                                          CodeAttribs codAt2) {
+    operand lhs = codAt1.addr;
+    instructionList &code1 = codAt1.code;
 
-    std::string rhs = codAt2.addr;
+    operand rhs = codAt2.addr;
     instructionList &code2 = codAt2.code;
-    instructionList &&code = code1 || code2;
+    instructionList code = std::move(code1) || std::move(code2);
     TypesMgr::TypeId t1 = getTypeDecor(ctx->expr(0));
     TypesMgr::TypeId t2 = getTypeDecor(ctx->expr(1));
     TypesMgr::TypeId t = getTypeDecor(ctx);
 
-    std::string temp = newTemp();
+    TreeLowering::Tag oper = Lowered.getTag(ctx);
+    operand temp = newTemp();
     if (Types.isFloatTy(t)) {
         if (Types.isIntegerTy(t1)) {
-            std::string temp = newTemp();
-            code = code || instruction::FLOAT(temp, lhs);
+            operand temp = newTemp();
+            code += instruction::FLOAT(temp, lhs);
             lhs = temp;
         }
         if (Types.isIntegerTy(t2)) {
-            std::string temp = newTemp();
-            code = code || instruction::FLOAT(temp, rhs);
+            operand temp = newTemp();
+            code += instruction::FLOAT(temp, rhs);
             rhs = temp;
         }
 
-        if (ctx->MUL())
-            code = code || instruction::FMUL(temp, lhs, rhs);
-        else if (ctx->DIV())
-            code = code || instruction::FDIV(temp, lhs, rhs);
-        else if (ctx->PLUS())
-            code = code || instruction::FADD(temp, lhs, rhs);
-        else if (ctx->MINUS())
-            code = code || instruction::FSUB(temp, lhs, rhs);
+        if (oper == TreeLowering::Mul)
+            code += instruction::FMUL(temp, lhs, rhs);
+        else if (oper == TreeLowering::Div)
+            code += instruction::FDIV(temp, lhs, rhs);
+        else if (oper == TreeLowering::Plus)
+            code += instruction::FADD(temp, lhs, rhs);
+        else if (oper == TreeLowering::Minus)
+            code += instruction::FSUB(temp, lhs, rhs);
     } else {
-        if (ctx->MUL())
-            code = code || instruction::MUL(temp, lhs, rhs);
-        else if (ctx->DIV())
-            code = code || instruction::DIV(temp, lhs, rhs);
-        else if (ctx->MOD()) {
+        if (oper == TreeLowering::Mul)
+            code += instruction::MUL(temp, lhs, rhs);
+        else if (oper == TreeLowering::Div)
+            code += instruction::DIV(temp, lhs, rhs);
+        else if (oper == TreeLowering::Mod) {
             // a % b = a - b*int(a/b)
-            code = code || instruction::DIV(temp, lhs, rhs);
-            code = code || instruction::MUL(temp, rhs, temp);
-            code = code || instruction::SUB(temp, lhs, temp);
-        } else if (ctx->PLUS())
-            code = code || instruction::ADD(temp, lhs, rhs);
-        else if (ctx->MINUS())
-            code = code || instruction::SUB(temp, lhs, rhs);
+            code += instruction::DIV(temp, lhs, rhs);
+            code += instruction::MUL(temp, rhs, temp);
+            code += instruction::SUB(temp, lhs, temp);
+        } else if (oper == TreeLowering::Plus)
+            code += instruction::ADD(temp, lhs, rhs);
+        else if (oper == TreeLowering::Minus)
+            code += instruction::SUB(temp, lhs, rhs);
     }
 
-    CodeAttribs codAts(temp, "", code);
-    DEBUG_EXIT();
+    CodeAttribs codAts(temp, operand(), std::move(code));
     return codAts;
 }
 
 std::any CodeGenVisitor::visitUnary(AslParser::UnaryContext *ctx) {
     DEBUG_ENTER();
-    CodeAttribs &&codAt = std::any_cast<CodeAttribs>(visit(ctx->expr()));
-    std::string var = codAt.addr;
+    CodeAttribs codAt = visitAs<CodeAttribs>(ctx->expr());
+    operand var = codAt.addr;
     instructionList &code = codAt.code;
 
     TypesMgr::TypeId t = getTypeDecor(ctx->expr());
-    std::string result = var;
+    operand result = var;
 
-    if (ctx->NOT()) {
+    TreeLowering::Tag oper = Lowered.getTag(ctx);
+    if (oper == TreeLowering::Not) {
         result = newTemp();
-        code = code || instruction::NOT(result, var);
-    } else if (ctx->MINUS()) {
+        code += instruction::NOT(result, var);
+    } else if (oper == TreeLowering::Neg) {
         result = newTemp();
         if (Types.isIntegerTy(t))
-            code = code || instruction::NEG(result, var);
+            code += instruction::NEG(result, var);
         else if (Types.isFloatTy(t))
-            code = code || instruction::FNEG(result, var);
+            code += instruction::FNEG(result, var);
         
     }
 
-    CodeAttribs codAts(result, "", code);
+    CodeAttribs codAts(result, operand(), std::move(code));
     DEBUG_EXIT();
     return codAts;
 }
 
 std::any CodeGenVisitor::visitRelational(AslParser::RelationalContext *ctx) {
     DEBUG_ENTER();
-    CodeAttribs &&codAt1 = std::any_cast<CodeAttribs>(visit(ctx->expr(0)));
-    std::string lhs = codAt1.addr;
+    CodeAttribs codAts = genBinaryChain(ctx);
+    DEBUG_EXIT();
+    return codAts;
+}
+
+CodeGenVisitor::CodeAttribs CodeGenVisitor::genRelational(AslParser::RelationalContext *ctx,
+                                                          CodeAttribs codAt1,
+                                                          CodeAttribs codAt2) {
+    operand lhs = codAt1.addr;
     instructionList &code1 = codAt1.code;
 
-    CodeAttribs &&codAt2 = std::any_cast<CodeAttribs>(visit(ctx->expr(1)));
-    std::string rhs = codAt2.addr;
+    operand rhs = codAt2.addr;
     instructionList &code2 = codAt2.code;
-    instructionList &&code = code1 || code2;
+    instructionList code = std::move(code1) || std::move(code2);
 
     TypesMgr::TypeId t1 = getTypeDecor(ctx->expr(0));
     TypesMgr::TypeId t2 = getTypeDecor(ctx->expr(1));
     // TypesMgr::TypeId  t = getTypeDecor(ctx);
-    std::string temp = newTemp();
+    TreeLowering::Tag oper = Lowered.getTag(ctx);
+    operand temp = newTemp();
     if (Types.isFloatTy(t1) || Types.isFloatTy(t2))
     {
         if (Types.isIntegerTy(t1)) {
-            std::string temp = newTemp();
-            code = code || instruction::FLOAT(temp, lhs);
+            operand temp = newTemp();
+            code += instruction::FLOAT(temp, lhs);
             lhs = temp;
         }
         if (Types.isIntegerTy(t2)) {
-            std::string temp = newTemp();
-            code = code || instruction::FLOAT(temp, rhs);
+            operand temp = newTemp();
+            code += instruction::FLOAT(temp, rhs);
             rhs = temp;
         }
 
-        if (ctx->EQUAL())
-            code = code || instruction::FEQ(temp, lhs, rhs);
-        else if (ctx->NE()) {
-            code = code || instruction::FEQ(temp, lhs, rhs);
-            code = code || instruction::NOT(temp, temp);
-        } else if (ctx->LE())
-            code = code || instruction::FLE(temp, lhs, rhs);
-        else if (ctx->LT())
-            code = code || instruction::FLT(temp, lhs, rhs);
-        else if (ctx->GE()) {
-            code = code || instruction::FLT(temp, lhs, rhs);
-            code = code || instruction::NOT(temp, temp);
-        } else if (ctx->GT()) {
-            code = code || instruction::FLE(temp, lhs, rhs);
-            code = code || instruction::NOT(temp, temp);
+        if (oper == TreeLowering::Eq)
+            code += instruction::FEQ(temp, lhs, rhs);
+        else if (oper == TreeLowering::Ne) {
+            code += instruction::FEQ(temp, lhs, rhs);
+            code += instruction::NOT(temp, temp);
+        } else if (oper == TreeLowering::Le)
+            code += instruction::FLE(temp, lhs, rhs);
+        else if (oper == TreeLowering::Lt)
+            code += instruction::FLT(temp, lhs, rhs);
+        else if (oper == TreeLowering::Ge) {
+            code += instruction::FLT(temp, lhs, rhs);
+            code += instruction::NOT(temp, temp);
+        } else if (oper == TreeLowering::Gt) {
+            code += instruction::FLE(temp, lhs, rhs);
+            code += instruction::NOT(temp, temp);
         }
     } else {
-        if (ctx->EQUAL())
-            code = code || instruction::EQ(temp, lhs, rhs);
-        else if (ctx->NE()) {
-            code = code || instruction::EQ(temp, lhs, rhs);
-            code = code || instruction::NOT(temp, temp);
-        } else if (ctx->LE())
-            code = code || instruction::LE(temp, lhs, rhs);
-        else if (ctx->LT())
-            code = code || instruction::LT(temp, lhs, rhs);
-        else if (ctx->GE()) {
-            code = code || instruction::LT(temp, lhs, rhs);
-            code = code || instruction::NOT(temp, temp);
-        } else if (ctx->GT()) {
-            code = code || instruction::LE(temp, lhs, rhs);
-            code = code || instruction::NOT(temp, temp);
+        if (oper == TreeLowering::Eq)
+            code += instruction::EQ(temp, lhs, rhs);
+        else if (oper == TreeLowering::Ne) {
+            code += instruction::EQ(temp, lhs, rhs);
+            code += instruction::NOT(temp, temp);
+        } else if (oper == TreeLowering::Le)
+            code += instruction::LE(temp, lhs, rhs);
+        else if (oper == TreeLowering::Lt)
+            code += instruction::LT(temp, lhs, rhs);
+        else if (oper == TreeLowering::Ge) {
+            code += instruction::LT(temp, lhs, rhs);
+            code += instruction::NOT(temp, temp);
+        } else if (oper == TreeLowering::Gt) {
+            code += instruction::LE(temp, lhs, rhs);
+            code += instruction::NOT(temp, temp);
         }
     }
 
-    CodeAttribs codAts(temp, "", code);
-    DEBUG_EXIT();
+    CodeAttribs codAts(temp, operand(), std::move(code));
     return codAts;
 }
 
 std::any CodeGenVisitor::visitLogical(AslParser::LogicalContext *ctx) {
     DEBUG_ENTER();
-    CodeAttribs &&codAt1 = std::any_cast<CodeAttribs>(visit(ctx->expr(0)));
-    std::string addr1 = codAt1.addr;
+    CodeAttribs codAts = genBinaryChain(ctx);
+    DEBUG_EXIT();
+    return codAts;
+}
+
+CodeGenVisitor::CodeAttribs CodeGenVisitor::genLogical(AslParser::LogicalContext *ctx,
+                                                       CodeAttribs codAt1,
+                                                       CodeAttribs codAt2) {
+    operand addr1 = codAt1.addr;
     instructionList &code1 = codAt1.code;
-    CodeAttribs &&codAt2 = std::any_cast<CodeAttribs>(visit(ctx->expr(1)));
-    std::string addr2 = codAt2.addr;
+    operand addr2 = codAt2.addr;
     instructionList &code2 = codAt2.code;
-    instructionList &&code = code1 || code2;
+    instructionList code = std::move(code1) || std::move(code2);
     // TypesMgr::TypeId t1 = getTypeDecor(ctx->expr(0));
     // TypesMgr::TypeId t2 = getTypeDecor(ctx->expr(1));
     // TypesMgr::TypeId  t = getTypeDecor(ctx);
-    std::string temp = newTemp();
-    if (ctx->AND())
-        code = code || instruction::AND(temp, addr1, addr2);
-    else if (ctx->OR())
-        code = code || instruction::OR(temp, addr1, addr2);
-
-    CodeAttribs codAts(temp, "", code);
-    DEBUG_EXIT();
+    TreeLowering::Tag oper = Lowered.getTag(ctx);
+    operand temp = newTemp();
+    if (oper == TreeLowering::And)
+        code += instruction::AND(temp, addr1, addr2);
+    else if (oper == TreeLowering::Or)
+        code += instruction::OR(temp, addr1, addr2);
+
+    CodeAttribs codAts(temp, operand(), std::move(code));
     return codAts;
 }
 
 std::any CodeGenVisitor::visitValue(AslParser::ValueContext *ctx) {
     DEBUG_ENTER();
     instructionList code;
-    std::string temp = newTemp();
-    if (ctx->INTVAL())
-        code = instruction::ILOAD(temp, ctx->getText());
-    else if (ctx->FLOATVAL())
-        code = instruction::FLOAD(temp, ctx->getText());
-    else if (ctx->FALSE())
-        code = instruction::ILOAD(temp, "0");
-    else if (ctx->TRUE())
-        code = instruction::ILOAD(temp, "1");
-    else if (ctx->CHARVAL())
-        code = instruction::LOAD(temp, ctx->getText());
-
-    CodeAttribs codAts(temp, "", code);
+    operand temp = newTemp();
+    operand value = currSpellings->copy_of(Lowered.getLiteral(ctx),
+                                           Lowered.getSpellings());
+    switch (Lowered.getTag(ctx)) {
+    case TreeLowering::FloatVal:
+        code = instruction::FLOAD(temp, value);
+        break;
+    case TreeLowering::CharVal:
+        code = instruction::LOAD(temp, value);
+        break;
+    default:  // IntVal and BoolVal
+        code = instruction::ILOAD(temp, value);
+    }
+
+    CodeAttribs codAts(temp, operand(), std::move(code));
     DEBUG_EXIT();
     return codAts;
 }
 
 std::any CodeGenVisitor::visitExprIdent(AslParser::ExprIdentContext *ctx) {
     DEBUG_ENTER();
-    CodeAttribs &&codAts = std::any_cast<CodeAttribs>(visit(ctx->ident()));
+    CodeAttribs codAts = visitAs<CodeAttribs>(ctx->ident());
     DEBUG_EXIT();
     return codAts;
 }
 
 std::any CodeGenVisitor::visitIdent(AslParser::IdentContext *ctx) {
     DEBUG_ENTER();
-    CodeAttribs codAts(ctx->ID()->getText(), "", instructionList());
+    CodeAttribs codAts(nameOperand(Symbols.getName(Lowered.getAtom(ctx))), operand(),
+                       instructionList());
+    // The binding was resolved by the type check
+    SymTable::Binding binding = getBindingDecor(ctx);
+    codAts.reference = binding.cls == SymTable::Binding::Parameter and
+                       Types.isArrayTy(binding.type);
     DEBUG_EXIT();
     return codAts;
 }
 
 // Getters for the necessary tree node atributes:
 
-//   Scope and Type
+//   Scope, Type and Binding
 SymTable::ScopeId
-CodeGenVisitor::getScopeDecor(antlr4::ParserRuleContext *ctx) const {
+CodeGenVisitor::getScopeDecor(AslRuleContext *ctx) const {
     return Decorations.getScope(ctx);
 }
 TypesMgr::TypeId
-CodeGenVisitor::getTypeDecor(antlr4::ParserRuleContext *ctx) const {
+CodeGenVisitor::getTypeDecor(AslRuleContext *ctx) const {
     return Decorations.getType(ctx);
 }
+SymTable::Binding
+CodeGenVisitor::getBindingDecor(AslRuleContext *ctx) const {
+    return Decorations.getBinding(ctx);
+}
 
 // Constructors of the class CodeAttribs:
 //
-CodeGenVisitor::CodeAttribs::CodeAttribs(const std::string &addr,
-                                         const std::string &offs,
+CodeGenVisitor::CodeAttribs::CodeAttribs(const operand &addr,
+                                         const operand &offs,
                                          instructionList &code)
     : addr{addr}, offs{offs}, code{code} {}
 
-CodeGenVisitor::CodeAttribs::CodeAttribs(const std::string &addr,
-                                         const std::string &offs,
+CodeGenVisitor::CodeAttribs::CodeAttribs(const operand &addr,
+                                         const operand &offs,
                                          instructionList &&code)
-    : addr{addr}, offs{offs}, code{code} {}
+    : addr{addr}, offs{offs}, code{std::move(code)} {}
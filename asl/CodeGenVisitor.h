@@ -37,6 +37,8 @@
 #include "../common/TreeDecoration.h"
 #include "../common/code.h"
 
+#include "TreeLowering.h"
+
 #include <string>
 
 // using namespace std;
@@ -57,10 +59,20 @@ class CodeGenVisitor final : public AslBaseVisitor {
 
 public:
 
-  // Constructor
-  CodeGenVisitor(TypesMgr       & Types,
-                 SymTable       & Symbols,
-                 TreeDecoration & Decorations);
+  // Constructor. The functions of the program are translated
+  // concurrently by up to 'jobs' threads, with stacks of stackSize
+  // bytes (0 for the default size)
+  CodeGenVisitor(TypesMgr           & Types,
+                 SymTable           & Symbols,
+                 TreeDecoration     & Decorations,
+                 const TreeLowering & Lowered,
+                 unsigned int         jobs = 1,
+                 std::size_t          stackSize = 0);
+
+  // Translate a function on its own (streaming mode). The signatures
+  // of all the functions are already in the global scope
+  subroutine translateFunction(AslParser::FunctionContext *ctx,
+                               SymTable::ScopeId          globalScope);
 
   // Methods to visit each kind of node:
   std::any visitProgram(AslParser::ProgramContext *ctx);
@@ -103,18 +115,30 @@ private:
   TypesMgr        & Types;
   SymTable        & Symbols;
   TreeDecoration  & Decorations;
+  const TreeLowering & Lowered;
   counters          codeCounters;
+  // Number of threads that translate the functions, and the size of
+  // their stacks
+  unsigned int      numJobs;
+  std::size_t       stackSize;
+  // Current scope, used to look up the symbols without modifying
+  // the stack of scopes of the SymTable (shared by all the workers)
+  SymTable::ScopeId currScope;
   // Current function type (assigned before visit its instructions)
   TypesMgr::TypeId currFunctionType;
+  // Spellings of the subroutine being generated, where the names and
+  // the literals of its operands are interned
+  spellings       * currSpellings = nullptr;
 
   // Accessor/Mutator to the type (TypeId) of the current function
   TypesMgr::TypeId getCurrentFunctionTy ()                      const;
   void             setCurrentFunctionTy (TypesMgr::TypeId type);
 
   // Getters for the necessary tree node atributes:
-  //   Scope and Type
-  SymTable::ScopeId getScopeDecor (antlr4::ParserRuleContext *ctx) const;
-  TypesMgr::TypeId  getTypeDecor  (antlr4::ParserRuleContext *ctx) const;
+  //   Scope, Type and Binding
+  SymTable::ScopeId getScopeDecor   (AslRuleContext *ctx) const;
+  TypesMgr::TypeId  getTypeDecor    (AslRuleContext *ctx) const;
+  SymTable::Binding getBindingDecor (AslRuleContext *ctx) const;
 
 
   //////////////////////////////////////////////////////////////////
@@ -128,20 +152,24 @@ private:
     
   public:
     // Constructors
-    CodeAttribs(const std::string & addr,
-                const std::string & offs,
+    CodeAttribs(const operand & addr,
+                const operand & offs,
                 instructionList & code);
-    CodeAttribs(const std::string & addr,
-                const std::string & offs,
+    CodeAttribs(const operand & addr,
+                const operand & offs,
                 instructionList && code);
 
     // Attributes (publics):
     //   - the address that will hold the value of an expression
-    std::string addr;
-    //   - the offset applied to the address (for array access)
-    std::string offs;
+    operand addr;
+    //   - the offset applied to the address (for array access, empty
+    //     if there is none)
+    operand offs;
     //   - the three-address code associated to an statement/expression
     instructionList code;
+    //   - whether addr is an array parameter, that holds a reference
+    //     to the array instead of its elements
+    bool reference = false;
   };  // class CodeAttribs
 
 private:
@@ -153,37 +181,40 @@ private:
 
   struct ForRange {
     // Inclusive
-    const std::string& start;
+    operand start;
     // Exclusive
-    const std::string& end;
+    operand end;
 
-    const std::string& increment;
+    operand increment;
 
-    const std::string& index;
+    operand index;
     instructionList body;
   };
   struct Assign {
     TypesMgr::TypeId dstType;
-    const std::string& dst;
-    const std::string& dstOffset;
+    operand dst;
+    operand dstOffset;
+    // dst is an array parameter (see CodeAttribs::reference)
+    bool dstReference = false;
 
     TypesMgr::TypeId srcType;
-    const std::string& src;
-    const std::string& srcOffset;
+    operand src;
+    operand srcOffset;
+    bool srcReference = false;
   };
 
   struct If {
-    const std::string& condition;
+    operand condition;
     instructionList trueBody;
     instructionList falseBody;
   };
 
   struct FuncCall {
     TypesMgr::TypeId functionType;
-    const std::string& functionName;
+    operand functionName;
     const std::vector<CodeAttribs>& arguments;
     const std::vector<TypesMgr::TypeId>& argumentsTypes;
-    const std::string& result;
+    operand result;
   };
 
   instructionList inst(While);
@@ -194,9 +225,26 @@ private:
 
 
   // to get the value of an addr (normal, reference or with offset)
-  CodeAttribs inst_load(const std::string& addr, const std::string& offset="");
-
-  std::string newTemp();
+  CodeAttribs inst_load(const operand& addr, bool reference,
+                        const operand& offset=operand());
+
+  operand newTemp();
+  // NAME operand of an identifier, interned in the current subroutine
+  operand nameOperand(const std::string& name);
+
+  // Translation of the binary operators (see genBinaryChain). The
+  // operands have already been translated
+  CodeAttribs genBinaryChain(AslParser::ExprContext *ctx);
+  CodeAttribs genArithmetic(AslParser::ArithmeticContext *ctx,
+                            CodeAttribs lhs, CodeAttribs rhs);
+  CodeAttribs genRelational(AslParser::RelationalContext *ctx,
+                            CodeAttribs lhs, CodeAttribs rhs);
+  CodeAttribs genLogical(AslParser::LogicalContext *ctx,
+                         CodeAttribs lhs, CodeAttribs rhs);
+
+  // Typed visit: visits ctx and returns its result (of type T)
+  template <typename T>
+  T visitAs(antlr4::tree::ParseTree *ctx);
 
 
 };  // class CodeGenVisitor
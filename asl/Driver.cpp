@@ -0,0 +1,515 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    Driver - Runs the phases of the Asl compiler (parsing, semantic
+//             checks and code generation) over one source text
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "Driver.h"
+
+#include "antlr4-runtime.h"
+#include "AslLexer.h"
+#include "AslParser.h"
+
+#include "../common/TypesMgr.h"
+#include "../common/SymTable.h"
+#include "../common/TreeDecoration.h"
+#include "../common/SemErrors.h"
+#include "../common/LLVMCodeGen.h"
+#include "TreeLowering.h"
+#include "SymbolsVisitor.h"
+#include "TypeCheckVisitor.h"
+#include "../common/code.h"
+#include "../common/passes.h"
+#include "CodeGenVisitor.h"
+#include "FdStreamBuf.h"
+#include "StackThread.h"
+
+#include <sstream>
+#include <vector>
+#include <atomic>
+#include <memory>     // make_shared, unique_ptr
+#include <cstdio>     // tmpfile
+#include <cstdlib>    // EXIT_FAILURE, EXIT_SUCCESS
+#include <exception>  // exception_ptr
+
+#include <unistd.h>   // lseek
+
+// using namespace std;
+
+
+namespace {
+
+// The value of a numeric option: a decimal number, not smaller than min
+bool parseNumber(const std::string & text, unsigned int min, unsigned int & value) {
+  if (text.empty() or text.size() > 6 or
+      text.find_first_not_of("0123456789") != std::string::npos)
+    return false;
+  value = std::stoul(text);
+  return value >= min;
+}
+
+}  // namespace
+
+
+bool CompilerOptions::parseOption(const std::string & option) {
+  if      (option == "--noTypecheck") doTypeCheck = false;
+  else if (option == "--noCodegen")   doCodeGen   = false;
+  else if (option == "--genLLVM")     doLLVM      = true;
+  else if (option == "--fastParse")   fastParse   = true;
+  else if (option == "--sourceComments") sourceComments = true;
+  else if (option == "--stream")      streaming   = true;
+  else if (option.rfind("--typecheckJobs=", 0) == 0)
+    return parseNumber(option.substr(16), 1, typecheckJobs);
+  else if (option.rfind("--codegenJobs=", 0) == 0)
+    return parseNumber(option.substr(14), 1, codegenJobs);
+  else if (option.rfind("--stackSize=", 0) == 0)
+    return parseNumber(option.substr(12), 0, stackSizeMB);
+  else if (option == "-O0" or option == "-O1" or option == "-O2")
+    optLevel = option[2] - '0';
+  else if (option.rfind("--passes=", 0) == 0 and
+           pass_manager::is_valid(option.substr(9))) {
+    passes = option.substr(9);
+    customPasses = true;
+  }
+  else if (option == "--passStats")   passStats   = true;
+  else return false;
+  return true;
+}
+
+std::string CompilerOptions::pipeline() const {
+  return customPasses ? passes : pass_manager::preset(optLevel);
+}
+
+
+namespace {
+
+std::atomic<unsigned long> numFastParses(0);
+std::atomic<unsigned long> numFallbacks(0);
+
+
+// Start of a function in the source: byte offset and position of its
+// 'func' keyword
+struct FunctionChunk {
+  std::size_t begin;
+  std::size_t line;
+  std::size_t column;
+};
+
+// Restrict input to the function i of the source (up to the start of
+// the next one). It has to be done before the lexer is created, since
+// a lexer rewinds the input when its input stream is changed
+void selectChunk(MappedCharStream & input, const std::vector<FunctionChunk> & chunks,
+                 std::size_t i, std::size_t end) {
+  input.setWindow(chunks[i].begin, i+1 < chunks.size() ? chunks[i+1].begin : end);
+}
+
+// The lexer of a function counts the lines from its start in the source
+void setStartPosition(AslLexer & lexer, const FunctionChunk & chunk) {
+  lexer.setLine(chunk.line);
+  lexer.setCharPositionInLine(chunk.column);
+}
+
+// The t-code of the streaming mode, kept until the whole program has
+// been checked (a semantic error in a later function means that no
+// code is generated). It goes to an unnamed temporary file, so that it
+// does not stay in memory, or to a string if the file can not be made
+class CodeSpool {
+public:
+  CodeSpool() : file{std::tmpfile()} {
+    if (file != nullptr) {
+      buf = std::make_unique<FdStreamBuf>(fileno(file));
+      out.rdbuf(buf.get());
+    }
+    else
+      out.rdbuf(text.rdbuf());
+  }
+  ~CodeSpool() {
+    buf.reset();  // flushed before its file descriptor is closed
+    if (file != nullptr) std::fclose(file);
+  }
+  std::ostream & stream() {
+    return out;
+  }
+  // Write the code kept so far to os
+  void copyTo(std::ostream & os) {
+    if (file == nullptr) {
+      os << text.str();
+      return;
+    }
+    out.flush();
+    ::lseek(fileno(file), 0, SEEK_SET);
+    FdStreamBuf in(fileno(file));
+    if (in.sgetc() != std::char_traits<char>::eof())
+      os << &in;
+  }
+
+private:
+  std::FILE                  * file;
+  std::unique_ptr<FdStreamBuf> buf;
+  std::ostringstream           text;
+  std::ostream                 out{nullptr};
+};
+
+// Streaming mode (--stream): only the tokens, the tree and the
+// decorations of one function are kept at any time
+int compileStreaming(MappedCharStream     & input,
+                     const CompilerOptions & options,
+                     std::ostream         & tcode,
+                     std::ostream         & diags,
+                     std::ostream         & errs) {
+  StreamErrorListener errorListener(errs);
+
+  // split the source at the 'func' keywords. The tokens are dropped as
+  // they are read, and the lexical errors are reported when each
+  // function is lexed again
+  std::vector<FunctionChunk> chunks;
+  std::size_t end = input.size();
+  std::size_t eofLine = 1, eofColumn = 0;
+  {
+    AslLexer lexer(&input);
+    lexer.removeErrorListeners();
+    for (auto tok = lexer.nextToken(); ; tok = lexer.nextToken()) {
+      if (tok->getType() == AslLexer::FUNC)
+        chunks.push_back({tok->getStartIndex(), tok->getLine(), tok->getCharPositionInLine()});
+      else if (tok->getType() == antlr4::Token::EOF) {
+        eofLine   = tok->getLine();
+        eofColumn = tok->getCharPositionInLine();
+        break;
+      }
+    }
+  }
+  // whatever precedes the first function is parsed with it
+  if (chunks.empty())
+    chunks.push_back({input.start(), 1, 0});
+  else
+    chunks[0] = {input.start(), 1, 0};
+
+  TypesMgr          types;
+  SymTable          symbols(types);
+  SemErrors         errors;
+  SymTable::ScopeId globalScope = symbols.pushNewScope(SymTable::GLOBAL_SCOPE_NAME);
+
+  // first pass: declare all the functions from their signatures (the
+  // syntax errors are reported in the second pass)
+  if (options.doTypeCheck) {
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+      selectChunk(input, chunks, i, end);
+      AslLexer lexer(&input);
+      lexer.removeErrorListeners();
+      setStartPosition(lexer, chunks[i]);
+      antlr4::CommonTokenStream tokens(&lexer);
+      AslParser parser(&tokens);
+      parser.removeErrorListeners();
+      AslParser::SignatureContext *signature = parser.signature();
+      if (lexer.getNumberOfSyntaxErrors() > 0 or parser.getNumberOfSyntaxErrors() > 0)
+        continue;
+      TreeDecoration decorations(signature);
+      SymbolsVisitor symboldecl(types, symbols, decorations, errors);
+      symboldecl.visit(signature);
+    }
+  }
+
+  // second pass: each function is parsed, checked, translated,
+  // optimized and written, and its tokens and tree are freed before
+  // the next one
+  pass_manager passes(options.pipeline());
+  CodeSpool spool;
+  bool syntaxErrors = false;
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    selectChunk(input, chunks, i, end);
+    AslLexer lexer(&input);
+    lexer.removeErrorListeners();
+    lexer.addErrorListener(&errorListener);
+    setStartPosition(lexer, chunks[i]);
+    antlr4::CommonTokenStream tokens(&lexer);
+    AslParser parser(&tokens);
+    parser.removeErrorListeners();
+    parser.addErrorListener(&errorListener);
+    AslParser::Single_functionContext *tree = parser.single_function();
+    if (lexer.getNumberOfSyntaxErrors() > 0 or parser.getNumberOfSyntaxErrors() > 0)
+      syntaxErrors = true;
+    if (syntaxErrors or not options.doTypeCheck)
+      continue;
+
+    AslParser::FunctionContext *function = tree->function();
+    TreeDecoration decorations(tree);
+    TreeLowering   lowered(tree, symbols);
+    SymbolsVisitor symboldecl(types, symbols, decorations, errors, true);
+    symboldecl.visit(function);
+    TypeCheckVisitor typecheck(types, symbols, decorations, lowered, errors);
+    typecheck.checkFunction(function, globalScope);
+    if (errors.getNumberOfSemanticErrors() == 0 and options.doCodeGen) {
+      CodeGenVisitor codegenerator(types, symbols, decorations, lowered);
+      subroutine subr = codegenerator.translateFunction(function, globalScope);
+      passes.run(subr);
+      subr.dump(spool.stream(), options.sourceComments);
+    }
+    // the local scope of the function is freed with its tree (it is
+    // the last one created, so the next function reuses its ScopeId)
+    symbols.dropLastScope(decorations.getScope(function));
+  }
+  input.resetWindow();
+
+  if (syntaxErrors) {
+    diags << "Lexical and/or syntactical errors have been found." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (not options.doTypeCheck) {
+    diags << "-- Early stop: no typecheck has been made." << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (symbols.noMainProperlyDeclared())
+    errors.noMainProperlyDeclared(eofLine, eofColumn);
+  errors.print(diags);
+  if (errors.getNumberOfSemanticErrors() > 0) {
+    diags << "There are semantic errors: no code generated." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (not options.doCodeGen) {
+    diags << "-- Early stop: no code generated." << std::endl;
+    return EXIT_SUCCESS;
+  }
+  spool.copyTo(tcode);
+  tcode << std::endl;
+  if (options.passStats)
+    passes.dump_statistics(errs);
+  if (options.doLLVM)
+    diags << "-- No LLVM IR is generated in streaming mode." << std::endl;
+  return EXIT_SUCCESS;
+}
+
+}  // namespace
+
+ParseStatistics getParseStatistics() {
+  ParseStatistics stats;
+  stats.parses    = numFastParses;
+  stats.fallbacks = numFallbacks;
+  return stats;
+}
+
+void printParseStatistics(std::ostream & out) {
+  ParseStatistics stats = getParseStatistics();
+  out << "-- SLL parses: " << stats.parses << ", LL fallbacks: " << stats.fallbacks << std::endl;
+}
+
+
+std::string outputFileName(const std::string & filename, const std::string & ext) {
+  if (filename == "")
+    return "output" + ext;
+  std::size_t slashPos = filename.rfind("/");
+  std::size_t dotPos   = filename.rfind(".");
+  return filename.substr(slashPos+1, dotPos-slashPos-1) + ext;
+}
+
+
+StreamErrorListener::StreamErrorListener(std::ostream & out)
+  : out{out} {
+}
+
+void StreamErrorListener::syntaxError(antlr4::Recognizer *recognizer,
+                                      antlr4::Token *offendingSymbol,
+                                      std::size_t line,
+                                      std::size_t charPositionInLine,
+                                      const std::string & msg,
+                                      std::exception_ptr e) {
+  out << "line " << line << ":" << charPositionInLine << " " << msg << std::endl;
+}
+
+
+namespace {
+
+// Compile the whole program at once (the default mode)
+int compileProgram(MappedCharStream     & input,
+                   const CompilerOptions & options,
+                   std::ostream         & tcode,
+                   std::ostream         & diags,
+                   std::ostream         & errs,
+                   std::ostream         * llvmCode) {
+
+  // syntax errors are reported to errs instead of the default std::cerr
+  StreamErrorListener errorListener(errs);
+
+  // create a lexer that consumes the character stream and produces a token stream
+  AslLexer lexer(&input);
+  lexer.removeErrorListeners();
+  lexer.addErrorListener(&errorListener);
+  antlr4::CommonTokenStream tokens(&lexer);
+
+  // create a parser that consumes the token stream, and parses it.
+  AslParser parser(&tokens);
+  parser.removeErrorListeners();
+  parser.addErrorListener(&errorListener);
+
+  // call the parser and get the parse tree
+  antlr4::tree::ParseTree *tree = nullptr;
+  if (not options.fastParse)
+    tree = parser.program();
+  else {
+    // first stage: SLL prediction, giving up at the first error. The
+    // lexical errors are kept apart until we know the tokens are good
+    std::ostringstream lexerErrs;
+    StreamErrorListener lexerErrorListener(lexerErrs);
+    lexer.removeErrorListeners();
+    lexer.addErrorListener(&lexerErrorListener);
+    parser.removeErrorListeners();
+    parser.setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+    parser.getInterpreter<antlr4::atn::ParserATNSimulator>()->setPredictionMode(antlr4::atn::PredictionMode::SLL);
+    ++numFastParses;
+    try {
+      tree = parser.program();
+      errs << lexerErrs.str();
+    }
+    catch (const antlr4::ParseCancellationException &) {
+      // second stage: lex and parse again from the start with full LL
+      // and the default error strategy, so the errors are reported
+      // (in the same order) as in a normal parse
+      ++numFallbacks;
+      lexer.removeErrorListeners();
+      lexer.addErrorListener(&errorListener);
+      lexer.reset();
+      tokens.setTokenSource(&lexer);
+      parser.setTokenStream(&tokens);
+      parser.addErrorListener(&errorListener);
+      parser.setErrorHandler(std::make_shared<antlr4::DefaultErrorStrategy>());
+      parser.getInterpreter<antlr4::atn::ParserATNSimulator>()->setPredictionMode(antlr4::atn::PredictionMode::LL);
+      tree = parser.program();
+    }
+  }
+
+  // check for lexical or syntactical errors
+  if (lexer.getNumberOfSyntaxErrors() > 0 or
+      parser.getNumberOfSyntaxErrors() > 0) {
+    diags << "Lexical and/or syntactical errors have been found." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // print the parse tree (for debugging purposes)
+  // diags << tree->toStringTree(&parser) << std::endl;
+
+  if (not options.doTypeCheck) {
+    diags << "-- Early stop: no typecheck has been made." << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  // auxililary classes we are going to need to store information while
+  // traversing the tree. They are described below in this document
+  TypesMgr       types;
+  SymTable       symbols(types);
+  TreeDecoration decorations(tree);
+  SemErrors      errors;
+
+  // lower the identifiers, literals and operators of the tree once
+  // (the nodes have already been numbered by the TreeDecoration)
+  TreeLowering   lowered(tree, symbols);
+
+  // create a visitor that looks for variables and function declarations
+  // in the tree and stores required information
+  SymbolsVisitor symboldecl(types, symbols, decorations, errors);
+  symboldecl.visit(tree);
+
+  // create another visitor that will perform type checkings wherever
+  // it is needed (on expressions, assignments, parameter passing, etc)
+  TypeCheckVisitor typecheck(types, symbols, decorations, lowered, errors,
+                             options.typecheckJobs, std::size_t(options.stackSizeMB) << 20);
+  typecheck.visit(tree);
+  errors.print(diags);
+
+  if (errors.getNumberOfSemanticErrors() > 0) {
+    diags << "There are semantic errors: no code generated." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (not options.doCodeGen) {
+    diags << "-- Early stop: no code generated." << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  // create a third visitor that will return the generated code
+  // for each part of the tree, and will store it in 'mycode'
+  CodeGenVisitor codegenerator(types, symbols, decorations, lowered,
+                               options.codegenJobs, std::size_t(options.stackSizeMB) << 20);
+  code mycode = std::any_cast<code>(codegenerator.visit(tree));
+
+  // optimize it (nothing is done with -O0)
+  pass_manager passes(options.pipeline());
+  passes.run(mycode);
+  if (options.passStats)
+    passes.dump_statistics(errs);
+
+  // print generated code as output (streamed, one subroutine at a time)
+  mycode.dump(tcode, options.sourceComments);
+  tcode << std::endl;
+
+  if (options.doLLVM and llvmCode != nullptr) {
+    try {
+      mycode.dumpLLVM(types, symbols, *llvmCode, options.sourceComments);
+    }
+    catch (const LLVMCodeGenError & e) {
+      errs << e.what();
+      return e.getStatus();
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+// Sources smaller than this are compiled in the calling thread: their
+// nesting cannot be deep enough to need more than its stack
+const std::size_t SmallInputBytes = 4096;
+
+}  // namespace
+
+
+// The parser and the visitors recurse on the nesting of the program
+// (expressions in parenthesis, right operands, nested statements; the
+// chains of binary operators are handled iteratively), so inputs with
+// a deep nesting need a stack larger than the default one of the
+// threads. The compilation of a source that is not small runs in its
+// own thread, with a stack of options.stackSizeMB megabytes, and so do
+// the threads of --typecheckJobs and --codegenJobs
+int compile(MappedCharStream     & input,
+            const CompilerOptions & options,
+            std::ostream         & tcode,
+            std::ostream         & diags,
+            std::ostream         & errs,
+            std::ostream         * llvmCode) {
+  CompilerOptions opts = options;
+  if (input.size() < SmallInputBytes)
+    opts.stackSizeMB = 0;
+  auto body = [&]() {
+    return opts.streaming ?
+      compileStreaming(input, opts, tcode, diags, errs) :
+      compileProgram(input, opts, tcode, diags, errs, llvmCode);
+  };
+  if (opts.stackSizeMB == 0)
+    return body();
+  int status = EXIT_FAILURE;
+  StackThread compilation(std::size_t(opts.stackSizeMB) << 20, [&]() { status = body(); });
+  compilation.join();
+  return status;
+}
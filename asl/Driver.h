@@ -0,0 +1,149 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    Driver - Runs the phases of the Asl compiler (parsing, semantic
+//             checks and code generation) over one source text
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "antlr4-runtime.h"
+#include "../common/MappedCharStream.h"
+
+#include <string>
+#include <ostream>
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Struct CompilerOptions: the phases and modes of the compiler
+// selected by the command line options.
+
+struct CompilerOptions {
+  // --noTypecheck, --noCodegen, --genLLVM
+  bool         doTypeCheck    = true;
+  bool         doCodeGen      = true;
+  bool         doLLVM         = false;
+  // --fastParse: parse in SLL mode first, and in LL mode only if it fails
+  bool         fastParse      = false;
+  // --sourceComments: line:column of each statement in the t-code and IR
+  bool         sourceComments = false;
+  // --stream: parse, check, translate and write one function at a time
+  // (no --fastParse, jobs or --genLLVM; only the function passes)
+  bool         streaming      = false;
+  // --typecheckJobs=N, --codegenJobs=N: threads that check/translate
+  // the functions
+  unsigned int typecheckJobs  = 1;
+  unsigned int codegenJobs    = 1;
+  // --stackSize=N: stack (MB) of the compilation of a source that is
+  // not small, and of the jobs threads (0: the calling thread)
+  unsigned int stackSizeMB    = 512;
+  // -O0 (no passes), -O1, -O2
+  unsigned int optLevel       = 0;
+  // --passes=name,...: the passes to run instead of the -O preset
+  std::string  passes         = "";
+  bool         customPasses   = false;
+  // --passStats: time and instructions removed by each pass (to errs)
+  bool         passStats      = false;
+
+  // Parse one command line option. Returns false if it is not a
+  // valid option (it may be a file name) or its value is not valid
+  bool parseOption(const std::string & option);
+  // The passes to run: those of --passes if given, or the preset of
+  // the optimization level
+  std::string pipeline() const;
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// Class StreamErrorListener: reports the lexical and syntactical
+// errors with the same format than antlr4::ConsoleErrorListener,
+// but writing them to the given stream instead of std::cerr.
+
+class StreamErrorListener : public antlr4::BaseErrorListener {
+
+public:
+
+  StreamErrorListener(std::ostream & out);
+
+  void syntaxError(antlr4::Recognizer *recognizer,
+                   antlr4::Token *offendingSymbol,
+                   std::size_t line,
+                   std::size_t charPositionInLine,
+                   const std::string & msg,
+                   std::exception_ptr e) override;
+
+private:
+  std::ostream & out;
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// Number of programs parsed with --fastParse and how many of them had
+// to be parsed again in full LL mode (for all the compilations done by
+// this process)
+
+struct ParseStatistics {
+  unsigned long parses    = 0;
+  unsigned long fallbacks = 0;
+};
+
+ParseStatistics getParseStatistics();
+// Write the statistics as "-- SLL parses: N, LL fallbacks: M"
+void            printParseStatistics(std::ostream & out);
+
+
+//////////////////////////////////////////////////////////////////////
+// Name of an output file generated in the current directory for the
+// source file filename: its base name with extension ext (".ll", ...).
+// For an empty filename (source read from std::cin) "output" is used.
+
+std::string outputFileName(const std::string & filename, const std::string & ext);
+
+
+//////////////////////////////////////////////////////////////////////
+// Compile the source text read from input. Every request gets its
+// own TypesMgr, SymTable, TreeDecoration and SemErrors, so the only
+// state shared between calls is the DFA cache of the generated lexer
+// and parser.
+//   - tcode receives the generated t-code
+//   - diags receives the messages of the compiler (semantic errors,
+//     early stops, ...) that are written to std::cout in a single run
+//   - errs receives the lexical/syntactical errors and the warnings
+//     of the LLVM emitter (written to std::cerr in a single run)
+//   - llvmCode, if not null and options.doLLVM is set, receives the
+//     generated LLVM IR, written function by function as it is
+//     translated. Nothing is written if the t-code is rejected by the
+//     emitter, but if the translation of a function fails (status
+//     EXIT_FAILURE) the IR of the previous ones has already been written
+// Returns the exit status of the compilation.
+
+int compile(MappedCharStream     & input,
+            const CompilerOptions & options,
+            std::ostream         & tcode,
+            std::ostream         & diags,
+            std::ostream         & errs,
+            std::ostream         * llvmCode = nullptr);
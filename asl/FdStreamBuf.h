@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    FdStreamBuf - Stream buffer over a file descriptor
+//                  (the connections of the compilation server)
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <streambuf>
+#include <cerrno>
+
+#include <unistd.h>
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class FdStreamBuf: stream buffer over a file descriptor, used for
+// the connections of the Unix socket of the server (on both ends).
+
+class FdStreamBuf : public std::streambuf {
+public:
+  FdStreamBuf(int fd) : fd{fd} {
+    setg(inBuf, inBuf, inBuf);
+    setp(outBuf, outBuf + sizeof(outBuf));
+  }
+  ~FdStreamBuf() {
+    sync();
+  }
+
+protected:
+  int_type underflow() override {
+    ssize_t n;
+    do n = ::read(fd, inBuf, sizeof(inBuf));
+    while (n < 0 and errno == EINTR);
+    if (n <= 0) return traits_type::eof();
+    setg(inBuf, inBuf, inBuf + n);
+    return traits_type::to_int_type(*gptr());
+  }
+
+  int_type overflow(int_type c) override {
+    if (sync() == -1) return traits_type::eof();
+    if (not traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override {
+    const char *p = pbase();
+    while (p < pptr()) {
+      ssize_t n = ::write(fd, p, pptr() - p);
+      if (n < 0 and errno == EINTR) continue;
+      if (n <= 0) return -1;
+      p += n;
+    }
+    setp(outBuf, outBuf + sizeof(outBuf));
+    return 0;
+  }
+
+private:
+  int  fd;
+  char inBuf[4096];
+  char outBuf[4096];
+};  // class FdStreamBuf
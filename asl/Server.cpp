@@ -0,0 +1,190 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    Server - Resident compilation server for the Asl compiler.
+//             Keeps the lexer/parser caches warm between requests
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "Server.h"
+#include "Driver.h"
+#include "FdStreamBuf.h"
+
+#include "antlr4-runtime.h"
+#include "AslLexer.h"
+#include "AslParser.h"
+#include "../common/MappedCharStream.h"
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib>    // EXIT_FAILURE, EXIT_SUCCESS
+#include <cerrno>
+#include <csignal>
+#include <cstring>    // strerror
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>   // chmod
+#include <unistd.h>
+
+// using namespace std;
+
+
+namespace {
+
+// Write one section of the answer: its name, its length and its contents
+void writeSection(std::ostream & out, const std::string & name, const std::string & text) {
+  out << name << " " << text.size() << "\n" << text;
+}
+
+void writeAnswer(std::ostream & out, int status,
+                 const std::string & tcode, const std::string & llvm,
+                 const std::string & diags, const std::string & errs = "") {
+  out << "status " << status << "\n";
+  writeSection(out, "tcode", tcode);
+  writeSection(out, "llvm", llvm);
+  writeSection(out, "diagnostics", diags);
+  writeSection(out, "errs", errs);
+  out << "end" << std::endl;
+}
+
+}  // namespace
+
+
+void serveRequests(std::istream & in, std::ostream & out) {
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream words(line);
+    std::string command;
+    words >> command;
+    if (command == "") continue;
+    if (command == "quit") break;
+
+    // options of the request and its argument (file name or length)
+    CompilerOptions options;
+    std::string word, argument;
+    while (words >> word)
+      if (not options.parseOption(word)) {
+        std::getline(words, argument);
+        argument = word + argument;
+        break;
+      }
+
+    std::ostringstream tcode, llvm, diags, errs;
+    int status = EXIT_FAILURE;
+    if (command == "compile") {
+      MappedCharStream input;
+      if (argument == "")
+        diags << "Missing file name: " << line << std::endl;
+      else if (not input.open(argument))
+        diags << "Could not open file: " << argument << std::endl;
+      else
+        status = compile(input, options, tcode, diags, errs, &llvm);
+    }
+    else if (command == "inline") {
+      std::size_t nbytes = 0;
+      std::istringstream length(argument);
+      if (not (length >> nbytes)) {
+        writeAnswer(out, EXIT_FAILURE, "", "", "Invalid request: " + line + "\n");
+        return;  // can not know where the next request starts
+      }
+      std::string source(nbytes, '\0');
+      in.read(&source[0], nbytes);
+      if (std::size_t(in.gcount()) != nbytes) {
+        writeAnswer(out, EXIT_FAILURE, "", "", "Incomplete source text\n");
+        return;
+      }
+      MappedCharStream input;
+      input.load(std::move(source));
+      status = compile(input, options, tcode, diags, errs, &llvm);
+    }
+    else if (command == "stats") {
+      printParseStatistics(diags);
+      status = EXIT_SUCCESS;
+    }
+    else
+      diags << "Invalid request: " << line << std::endl;
+    // the IR of a failed translation is not sent
+    if (status != EXIT_SUCCESS) llvm.str("");
+    writeAnswer(out, status, tcode.str(), llvm.str(), diags.str(), errs.str());
+  }
+}
+
+int runServer(const std::string & socketPath) {
+  // build the shared ATN/DFA structures once, before the first request
+  AslLexer::initialize();
+  AslParser::initialize();
+
+  if (socketPath == "") {
+    serveRequests(std::cin, std::cout);
+    return EXIT_SUCCESS;
+  }
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "Socket path too long: " << socketPath << std::endl;
+    return EXIT_FAILURE;
+  }
+  socketPath.copy(addr.sun_path, socketPath.size());
+
+  int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ::unlink(socketPath.c_str());
+  if (server < 0 or
+      ::bind(server, (sockaddr *) &addr, sizeof(addr)) < 0 or
+      // only the user that runs the server can connect (and make it
+      // read any file it can read)
+      ::chmod(socketPath.c_str(), 0600) < 0 or
+      ::listen(server, SOMAXCONN) < 0) {
+    std::cerr << "Could not listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+    return EXIT_FAILURE;
+  }
+  // a client that goes away must not kill the server
+  std::signal(SIGPIPE, SIG_IGN);
+
+  while (true) {
+    int conn = ::accept(server, nullptr, nullptr);
+    if (conn < 0) {
+      if (errno == EINTR) continue;
+      std::cerr << "accept: " << std::strerror(errno) << std::endl;
+      break;
+    }
+    // each connection is served by its own thread, so a client that
+    // does not send its request (or read the answer) does not block
+    // the others. The compilations share only the DFA caches
+    std::thread([conn]() {
+      {
+        FdStreamBuf buf(conn);
+        std::istream in(&buf);
+        std::ostream out(&buf);
+        serveRequests(in, out);
+      }
+      ::close(conn);
+    }).detach();
+  }
+  ::close(server);
+  ::unlink(socketPath.c_str());
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,70 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    Server - Resident compilation server for the Asl compiler.
+//             Keeps the lexer/parser caches warm between requests
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <istream>
+#include <ostream>
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Server mode (asl --server[=<socket path>]).
+// The compiler stays resident and reads compile requests, one per
+// line, from std::cin (or from each connection to a Unix socket,
+// served by its own thread; the socket is only open to its owner).
+// Requests:
+//   compile [--noTypecheck|--noCodegen|--genLLVM]... <file.asl>
+//   inline  [--noTypecheck|--noCodegen|--genLLVM]... <nbytes>
+//           (followed by exactly nbytes of source text)
+//   stats   (the --fastParse statistics are given as diagnostics)
+//   quit
+// Every request is answered with:
+//   status <exit status of the compilation>
+//   tcode <nbytes>          followed by the generated t-code
+//   llvm <nbytes>           followed by the LLVM IR (if --genLLVM)
+//   diagnostics <nbytes>    followed by the messages and the semantic
+//                           errors (written to std::cout in a single run)
+//   errs <nbytes>           followed by the lexical/syntactical errors and
+//                           the warnings of the LLVM emitter (written to
+//                           std::cerr in a single run)
+//   end
+// The lexer and parser DFA caches are shared by all the requests,
+// but each compilation gets fresh semantic tables. The short-lived
+// runs of the compiler can use them with --client (see Client.h).
+
+// Serve the requests read from in, writing the answers to out,
+// until a 'quit' request or the end of the input
+void serveRequests(std::istream & in, std::ostream & out);
+
+// Run the server on std::cin/std::cout (if socketPath is empty) or
+// listening on the Unix socket socketPath. Returns the exit status.
+int runServer(const std::string & socketPath);
@@ -0,0 +1,97 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    StackThread - Thread with a stack of a given size
+//                  (for the deep recursions of the compiler)
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <functional>
+#include <exception>  // exception_ptr
+#include <cstddef>    // std::size_t
+
+#include <pthread.h>
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class StackThread: runs a function in a new thread with a stack of
+// stackSize bytes (std::thread always gets the default size). The
+// stack is only reserved address space; its pages are allocated as
+// they are used. A stackSize of 0 gives the default size. If the
+// thread cannot be created, the function is run by join() in the
+// calling thread. An exception of the function is rethrown by join().
+
+class StackThread {
+public:
+  StackThread(std::size_t stackSize, std::function<void()> body)
+    : body{std::move(body)} {
+    pthread_attr_t attr;
+    if (pthread_attr_init(&attr) != 0)
+      return;
+    started = (stackSize == 0 or pthread_attr_setstacksize(&attr, stackSize) == 0) and
+              pthread_create(&thread, &attr, run, this) == 0;
+    pthread_attr_destroy(&attr);
+  }
+  StackThread(const StackThread &) = delete;
+  StackThread & operator=(const StackThread &) = delete;
+  ~StackThread() {
+    if (started) pthread_join(thread, nullptr);
+  }
+
+  // Wait for the function to finish
+  void join() {
+    if (started) {
+      pthread_join(thread, nullptr);
+      started = false;
+    }
+    else if (body)
+      guarded();
+    body = nullptr;
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+private:
+  std::function<void()> body;
+  pthread_t             thread;
+  bool                  started = false;
+  std::exception_ptr    error;
+
+  void guarded() {
+    try {
+      body();
+    }
+    catch (...) {
+      error = std::current_exception();
+    }
+  }
+  static void *run(void *self) {
+    static_cast<StackThread *>(self)->guarded();
+    return nullptr;
+  }
+};  // class StackThread
@@ -52,11 +52,13 @@
 SymbolsVisitor::SymbolsVisitor(TypesMgr& Types,
                                SymTable& Symbols,
                                TreeDecoration& Decorations,
-                               SemErrors& Errors)
+                               SemErrors& Errors,
+                               bool functionsDeclared)
     : Types{Types},
       Symbols{Symbols},
       Decorations{Decorations},
-      Errors{Errors} {}
+      Errors{Errors},
+      functionsDeclared{functionsDeclared} {}
 
 // Methods to visit each kind of node:
 //
@@ -85,24 +87,41 @@ std::any SymbolsVisitor::visitFunction(AslParser::FunctionContext* ctx) {
   visit(ctx->declarations());
 
   Symbols.popScope();
-  std::string ident = ctx->ID()->getText();
-  if (Symbols.findInCurrentScope(ident)) {
-    Errors.declaredIdent(ctx->ID());
+  if (not functionsDeclared)
+    declareFunction(ctx->ID(), ctx->parameters(), ctx->basic_type());
+  DEBUG_EXIT();
+  return 0;
+}
+
+std::any SymbolsVisitor::visitSignature(AslParser::SignatureContext* ctx) {
+  DEBUG_ENTER();
+  for (auto param : ctx->parameters()->parameter())
+    visit(param->type());
+  if (ctx->basic_type())
+    visit(ctx->basic_type());
+  declareFunction(ctx->ID(), ctx->parameters(), ctx->basic_type());
+  DEBUG_EXIT();
+  return 0;
+}
+
+void SymbolsVisitor::declareFunction(antlr4::tree::TerminalNode* ident,
+                                     AslParser::ParametersContext* params,
+                                     AslParser::Basic_typeContext* retType) {
+  if (Symbols.findInCurrentScope(ident->getText())) {
+    Errors.declaredIdent(ident);
   } else {
     std::vector<TypesMgr::TypeId> paramsTy;
 
-    for (auto param : ctx->parameters()->parameter())
+    for (auto param : params->parameter())
       paramsTy.push_back(getTypeDecor(param->type()));
 
     TypesMgr::TypeId tRet = Types.createVoidTy();
-    if (ctx->basic_type())
-      tRet = getTypeDecor(ctx->basic_type());
+    if (retType)
+      tRet = getTypeDecor(retType);
 
     TypesMgr::TypeId tFunc = Types.createFunctionTy(paramsTy, tRet);
-    Symbols.addFunction(ident, tFunc);
+    Symbols.addFunction(ident->getText(), tFunc);
   }
-  DEBUG_EXIT();
-  return 0;
 }
 
 std::any SymbolsVisitor::visitParameters(AslParser::ParametersContext* ctx) {
@@ -293,20 +312,20 @@ std::any SymbolsVisitor::visitTypeArray(AslParser::TypeArrayContext* ctx) {
 // Getters for the necessary tree node atributes:
 //   Scope and Type
 SymTable::ScopeId SymbolsVisitor::getScopeDecor(
-    antlr4::ParserRuleContext* ctx) {
+    AslRuleContext* ctx) {
   return Decorations.getScope(ctx);
 }
-TypesMgr::TypeId SymbolsVisitor::getTypeDecor(antlr4::ParserRuleContext* ctx) {
+TypesMgr::TypeId SymbolsVisitor::getTypeDecor(AslRuleContext* ctx) {
   return Decorations.getType(ctx);
 }
 
 // Setters for the necessary tree node attributes:
 //   Scope and Type
-void SymbolsVisitor::putScopeDecor(antlr4::ParserRuleContext* ctx,
+void SymbolsVisitor::putScopeDecor(AslRuleContext* ctx,
                                    SymTable::ScopeId s) {
   Decorations.putScope(ctx, s);
 }
-void SymbolsVisitor::putTypeDecor(antlr4::ParserRuleContext* ctx,
+void SymbolsVisitor::putTypeDecor(AslRuleContext* ctx,
                                   TypesMgr::TypeId t) {
   Decorations.putType(ctx, t);
 }
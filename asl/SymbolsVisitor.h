@@ -52,16 +52,20 @@ class SymbolsVisitor final : public AslBaseVisitor {
 
 public:
 
-  // Constructor
+  // Constructor. If the functions have already been declared by
+  // visiting their signatures (streaming mode), visitFunction only
+  // registers the parameters and local variables
   SymbolsVisitor(TypesMgr       & Types,
                  SymTable       & Symbols,
                  TreeDecoration & Decorations,
-                 SemErrors      & Errors);
+                 SemErrors      & Errors,
+                 bool             functionsDeclared = false);
 
   // Methods to visit each kind of node.
   // Non visited nodes have been commented out:
   std::any visitProgram(AslParser::ProgramContext *ctx);
   std::any visitFunction(AslParser::FunctionContext *ctx);
+  std::any visitSignature(AslParser::SignatureContext *ctx);
   std::any visitParameters(AslParser::ParametersContext *ctx);
   std::any visitParameter(AslParser::ParameterContext *ctx);
   std::any visitDeclarations(AslParser::DeclarationsContext *ctx);
@@ -91,15 +95,22 @@ private:
   SymTable       & Symbols;
   TreeDecoration & Decorations;
   SemErrors      & Errors;
+  bool             functionsDeclared;
+
+  // Add the function ident to the current scope, with the type given
+  // by the (already decorated) parameters and return type
+  void declareFunction (antlr4::tree::TerminalNode    *ident,
+                        AslParser::ParametersContext *params,
+                        AslParser::Basic_typeContext *retType);
 
   // Getters for the necessary tree node atributes:
   //   Scope and Type
-  SymTable::ScopeId getScopeDecor (antlr4::ParserRuleContext *ctx);
-  TypesMgr::TypeId  getTypeDecor  (antlr4::ParserRuleContext *ctx);
+  SymTable::ScopeId getScopeDecor (AslRuleContext *ctx);
+  TypesMgr::TypeId  getTypeDecor  (AslRuleContext *ctx);
 
   // Setters for the necessary tree node attributes:
   //   Scope and Type
-  void putScopeDecor (antlr4::ParserRuleContext *ctx, SymTable::ScopeId s);
-  void putTypeDecor  (antlr4::ParserRuleContext *ctx, TypesMgr::TypeId t);
+  void putScopeDecor (AslRuleContext *ctx, SymTable::ScopeId s);
+  void putTypeDecor  (AslRuleContext *ctx, TypesMgr::TypeId t);
 
 };  // class SymbolsVisitor
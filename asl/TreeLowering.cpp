@@ -0,0 +1,159 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    TreeLowering - Lower the parser tree once to compact tables
+//                   of node tags, identifiers and literals
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "TreeLowering.h"
+
+#include "antlr4-runtime.h"
+#include "AslParser.h"
+
+#include "../common/SymTable.h"
+#include "../common/AslRuleContext.h"
+#include "../common/code.h"
+
+#include <cassert>
+#include <string>
+
+// using namespace std;
+
+
+// Constructor: the tree is traversed with an explicit stack in the
+// same preorder used by the TreeDecoration to number the nodes
+TreeLowering::TreeLowering(antlr4::tree::ParseTree *tree, SymTable & Symbols) {
+  std::vector<antlr4::tree::ParseTree *> pending;
+  if (tree != nullptr)
+    pending.push_back(tree);
+  while (not pending.empty()) {
+    antlr4::tree::ParseTree *node = pending.back();
+    pending.pop_back();
+    if (node->getTreeType() != antlr4::tree::ParseTreeType::RULE)
+      continue;
+    AslRuleContext *ctx = static_cast<AslRuleContext *>(node);
+    assert(ctx->decorIndex == Tags.size());
+    Tag tag = Other;
+    std::uint32_t payload = 0;
+    if (auto ident = dynamic_cast<AslParser::IdentContext *>(ctx)) {
+      tag = Ident;
+      payload = Symbols.intern(ident->ID()->getSymbol()->getText());
+    }
+    else if (auto value = dynamic_cast<AslParser::ValueContext *>(ctx)) {
+      antlr4::Token *token = value->getStart();
+      switch (token->getType()) {
+      case AslParser::INTVAL:
+        tag = IntVal;
+        Literals.push_back(Words.integer(token->getText()));
+        break;
+      case AslParser::FLOATVAL:
+        tag = FloatVal;
+        Literals.push_back(Words.floating(token->getText()));
+        break;
+      case AslParser::CHARVAL:
+        tag = CharVal;
+        Literals.push_back(Words.character(token->getText()));
+        break;
+      default:  // TRUE or FALSE
+        tag = BoolVal;
+        Literals.push_back(operand::integer(token->getType() == AslParser::TRUE));
+      }
+      payload = Literals.size() - 1;
+    }
+    else if (auto unary = dynamic_cast<AslParser::UnaryContext *>(ctx)) {
+      tag = operatorTag(unary->op);
+      if (tag == Plus)
+        tag = Pos;
+      else if (tag == Minus)
+        tag = Neg;
+    }
+    else if (auto arith = dynamic_cast<AslParser::ArithmeticContext *>(ctx))
+      tag = operatorTag(arith->op);
+    else if (auto rel = dynamic_cast<AslParser::RelationalContext *>(ctx))
+      tag = operatorTag(rel->op);
+    else if (auto logic = dynamic_cast<AslParser::LogicalContext *>(ctx))
+      tag = operatorTag(logic->op);
+    Tags.push_back(tag);
+    Payload.push_back(payload);
+    for (auto it = node->children.rbegin(); it != node->children.rend(); ++it)
+      pending.push_back(*it);
+  }
+}
+
+TreeLowering::Tag TreeLowering::operatorTag(antlr4::Token *op) {
+  switch (op->getType()) {
+  case AslParser::PLUS:   return Plus;
+  case AslParser::MINUS:  return Minus;
+  case AslParser::MUL:    return Mul;
+  case AslParser::DIV:    return Div;
+  case AslParser::MOD:    return Mod;
+  case AslParser::EQUAL:  return Eq;
+  case AslParser::NE:     return Ne;
+  case AslParser::LT:     return Lt;
+  case AslParser::LE:     return Le;
+  case AslParser::GT:     return Gt;
+  case AslParser::GE:     return Ge;
+  case AslParser::AND:    return And;
+  case AslParser::OR:     return Or;
+  case AslParser::NOT:    return Not;
+  default:                return Other;
+  }
+}
+
+bool TreeLowering::isBinary(Tag tag) {
+  return tag >= Plus and tag <= Or;
+}
+
+bool TreeLowering::isArithmetic(Tag tag) {
+  return tag >= Plus and tag <= Mod;
+}
+
+bool TreeLowering::isRelational(Tag tag) {
+  return tag >= Eq and tag <= Ge;
+}
+
+bool TreeLowering::isLogical(Tag tag) {
+  return tag == And or tag == Or;
+}
+
+// Getters:
+TreeLowering::Tag TreeLowering::getTag(AslRuleContext *ctx) const {
+  assert(ctx->decorIndex < Tags.size());
+  return Tags[ctx->decorIndex];
+}
+
+SymTable::Atom TreeLowering::getAtom(AslParser::IdentContext *ctx) const {
+  assert(getTag(ctx) == Ident);
+  return Payload[ctx->decorIndex];
+}
+
+const operand & TreeLowering::getLiteral(AslParser::ValueContext *ctx) const {
+  assert(getTag(ctx) >= IntVal and getTag(ctx) <= BoolVal);
+  return Literals[Payload[ctx->decorIndex]];
+}
+
+const spellings & TreeLowering::getSpellings() const {
+  return Words;
+}
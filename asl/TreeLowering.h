@@ -0,0 +1,109 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    TreeLowering - Lower the parser tree once to compact tables
+//                   of node tags, identifiers and literals
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "antlr4-runtime.h"
+#include "AslParser.h"
+
+#include "../common/SymTable.h"
+#include "../common/AslRuleContext.h"
+#include "../common/code.h"
+
+#include <cstdint>
+#include <vector>
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class TreeLowering: once the tree has been numbered by the
+// TreeDecoration, it is traversed a single time to lower the
+// information that the later phases need from the text of the
+// program into compact vectors indexed by the node number:
+//   - a one-byte tag for each expression node, that tells which
+//     operator it applies (or if it is an identifier or a literal),
+//     so that the visitors do not look for the operator token
+//     among the children
+//   - the Atom of each ident node, interned in the SymTable, so
+//     that the identifiers are not rebuilt from the tokens and
+//     hashed again at every use
+//   - the t-code operand of each literal, decoded once. The
+//     spellings of the float and char literals (and of the integer
+//     literals not written as their value, like 007) are interned in
+//     the TreeLowering, and the code generator copies them to the
+//     spellings of each subroutine
+// The visitors only read these tables, so they can be shared by
+// the threads that check and translate the functions in parallel.
+
+class TreeLowering {
+
+public:
+  // Tags of the nodes. The binary operators go from Plus to Or
+  typedef enum : std::uint8_t {
+    Other,
+    Ident,
+    IntVal, FloatVal, CharVal, BoolVal,
+    Plus, Minus, Mul, Div, Mod,
+    Eq, Ne, Lt, Le, Gt, Ge,
+    And, Or,
+    Not, Neg, Pos
+  } Tag;
+
+  // Classes of the tags of the binary operators
+  static bool isBinary     (Tag tag);
+  static bool isArithmetic (Tag tag);
+  static bool isRelational (Tag tag);
+  static bool isLogical    (Tag tag);
+
+  // Constructor: lower all the nodes of the (already numbered)
+  // tree, interning its identifiers in Symbols
+  TreeLowering(antlr4::tree::ParseTree *tree, SymTable & Symbols);
+
+  // Tag of a node (Other if it is not an expression)
+  Tag               getTag     (AslRuleContext *ctx) const;
+  // Atom of an ident node
+  SymTable::Atom    getAtom    (AslParser::IdentContext *ctx) const;
+  // Operand with the value of a literal
+  const operand &   getLiteral (AslParser::ValueContext *ctx) const;
+  // Spellings of the operands of the literals
+  const spellings & getSpellings () const;
+
+private:
+  std::vector<Tag>           Tags;
+  // Atom of the ident nodes, or position in Literals of the value
+  // nodes (unused for the rest)
+  std::vector<std::uint32_t> Payload;
+  std::vector<operand>       Literals;
+  spellings                  Words;
+
+  // Tag of an operator token
+  static Tag operatorTag (antlr4::Token *op);
+
+};  // class TreeLowering
@@ -35,8 +35,15 @@
 #include "../common/TreeDecoration.h"
 #include "../common/TypesMgr.h"
 
+#include "TreeLowering.h"
+#include "StackThread.h"
+
+#include <algorithm> // min, max
+#include <atomic>
 #include <iostream>
 #include <string>
+#include <list>
+#include <vector>
 
 // uncomment the following line to enable debugging messages with DEBUG*
 // #define DEBUG_BUILD
@@ -49,8 +56,18 @@
 // Constructor
 TypeCheckVisitor::TypeCheckVisitor(TypesMgr &Types, SymTable &Symbols,
                                    TreeDecoration &Decorations,
-                                   SemErrors &Errors)
-    : Types{Types}, Symbols{Symbols}, Decorations{Decorations}, Errors{Errors} {
+                                   const TreeLowering &Lowered,
+                                   SemErrors &Errors, unsigned int jobs,
+                                   std::size_t stackSize)
+    : Types{Types}, Symbols{Symbols}, Decorations{Decorations},
+      Lowered{Lowered}, Errors{Errors}, numJobs{std::max(1u, jobs)},
+      stackSize{stackSize} {
+}
+
+void TypeCheckVisitor::checkFunction(AslParser::FunctionContext *ctx,
+                                     SymTable::ScopeId globalScope) {
+    currScope = globalScope;
+    visit(ctx);
 }
 
 // Accessor/Mutator to the attribute currFunctionType.
@@ -71,15 +88,43 @@ std::any TypeCheckVisitor::visitProgram(AslParser::ProgramContext *ctx) {
 
     SymTable::ScopeId sc = getScopeDecor(ctx);
     Symbols.pushThisScope(sc);
+    currScope = sc;
 
-    for (auto ctxFunc : ctx->function())
-        visit(ctxFunc);
+    std::vector<AslParser::FunctionContext *> functions = ctx->function();
+    unsigned int jobs = std::min<std::size_t>(numJobs, functions.size());
+    if (jobs <= 1) {
+        for (auto ctxFunc : functions)
+            visit(ctxFunc);
+    } else {
+        // All the signatures are already in the SymTable, so the bodies
+        // can be checked in parallel. Each worker decorates the nodes of
+        // its own functions and puts its errors in its own SemErrors,
+        // that are merged when all the workers have finished
+        std::vector<SemErrors> errors(jobs);
+        std::vector<TypeCheckVisitor> workers;
+        workers.reserve(jobs);
+        for (unsigned int j = 0; j < jobs; ++j) {
+            workers.emplace_back(Types, Symbols, Decorations, Lowered, errors[j]);
+            workers[j].currScope = sc;
+        }
+        std::atomic<std::size_t> next(0);
+        auto worker = [&](TypeCheckVisitor &checker) {
+            for (std::size_t i = next++; i < functions.size(); i = next++)
+                checker.visit(functions[i]);
+        };
+        std::list<StackThread> pool;
+        for (unsigned int j = 0; j < jobs; ++j)
+            pool.emplace_back(stackSize, [&, j]() { worker(workers[j]); });
+        for (auto &t : pool)
+            t.join();
+        for (unsigned int j = 0; j < jobs; ++j)
+            Errors.merge(errors[j]);
+    }
 
     if (Symbols.noMainProperlyDeclared())
         Errors.noMainProperlyDeclared(ctx);
 
     Symbols.popScope();
-    Errors.print();
     DEBUG_EXIT();
     return 0;
 }
@@ -87,8 +132,8 @@ std::any TypeCheckVisitor::visitProgram(AslParser::ProgramContext *ctx) {
 std::any TypeCheckVisitor::visitFunction(AslParser::FunctionContext *ctx) {
     DEBUG_ENTER();
 
-    SymTable::ScopeId sc = getScopeDecor(ctx);
-    Symbols.pushThisScope(sc);
+    SymTable::ScopeId globalScope = currScope;
+    currScope = getScopeDecor(ctx);
 
     TypesMgr::TypeId tRet = Types.createVoidTy();
     if (ctx->basic_type())
@@ -98,7 +143,7 @@ std::any TypeCheckVisitor::visitFunction(AslParser::FunctionContext *ctx) {
 
     visit(ctx->statements());
 
-    Symbols.popScope();
+    currScope = globalScope;
     DEBUG_EXIT();
     return 0;
 }
@@ -209,7 +254,7 @@ std::any TypeCheckVisitor::visitProcCall(AslParser::ProcCallContext *ctx) {
             Errors.isNotCallable(ctx->ident());
         else {
 
-            auto &params = Types.getFuncParamsTypes(funcType);
+            auto params = Types.getFuncParamsTypes(funcType);
             if (params.size() != ctx->expr().size())
                 Errors.numberOfParameters(ctx->ident());
 
@@ -351,15 +396,15 @@ std::any TypeCheckVisitor::visitUnary(AslParser::UnaryContext *ctx) {
     DEBUG_ENTER();
     visit(ctx->expr());
     TypesMgr::TypeId t1 = getTypeDecor(ctx->expr());
-    // std::string oper = ctx->op->getText();
+    TreeLowering::Tag oper = Lowered.getTag(ctx);
 
     if (not Types.isErrorTy(t1)) {
-        if ((ctx->PLUS() || ctx->MINUS()) && not Types.isNumericTy(t1))
+        if (oper != TreeLowering::Not && not Types.isNumericTy(t1))
         {
             Errors.incompatibleOperator(ctx->op);
             t1 = Types.createErrorTy();
         }
-        else if (ctx->NOT() && not Types.isBooleanTy(t1))
+        else if (oper == TreeLowering::Not && not Types.isBooleanTy(t1))
         {
             Errors.incompatibleOperator(ctx->op);
             t1 = Types.createBooleanTy();
@@ -374,8 +419,40 @@ std::any TypeCheckVisitor::visitUnary(AslParser::UnaryContext *ctx) {
 
 std::any TypeCheckVisitor::visitArithmetic(AslParser::ArithmeticContext *ctx) {
     DEBUG_ENTER();
-    visit(ctx->expr(0));
-    visit(ctx->expr(1));
+    checkBinaryChain(ctx);
+    DEBUG_EXIT();
+    return 0;
+}
+
+// The left-recursive rules of expr give left-deep trees for the
+// chains of binary operators (a + b + c ...), that may be very long.
+// They are checked with an explicit stack: the chain is followed down
+// its left operands, and then the operators are checked bottom-up, so
+// only the right operands (and the expressions in parenthesis) are
+// visited recursively
+void TypeCheckVisitor::checkBinaryChain(AslParser::ExprContext *ctx) {
+    std::vector<AslParser::ExprContext *> chain;
+    AslParser::ExprContext *node = ctx;
+    while (TreeLowering::isBinary(Lowered.getTag(node))) {
+        chain.push_back(node);
+        node = static_cast<AslParser::ExprContext *>(node->children[0]);
+    }
+
+    visit(node);
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        node = *it;
+        visit(node->children[2]);
+        TreeLowering::Tag oper = Lowered.getTag(node);
+        if (TreeLowering::isArithmetic(oper))
+            checkArithmetic(static_cast<AslParser::ArithmeticContext *>(node));
+        else if (TreeLowering::isRelational(oper))
+            checkRelational(static_cast<AslParser::RelationalContext *>(node));
+        else
+            checkLogical(static_cast<AslParser::LogicalContext *>(node));
+    }
+}
+
+void TypeCheckVisitor::checkArithmetic(AslParser::ArithmeticContext *ctx) {
     TypesMgr::TypeId lhs = getTypeDecor(ctx->expr(0));
     TypesMgr::TypeId rhs = getTypeDecor(ctx->expr(1));
 
@@ -383,7 +460,7 @@ std::any TypeCheckVisitor::visitArithmetic(AslParser::ArithmeticContext *ctx) {
     error = error || (!Types.isErrorTy(lhs) && !Types.isNumericTy(lhs));
     error = error || (!Types.isErrorTy(rhs) && !Types.isNumericTy(rhs));
 
-    if (ctx->MOD()) {
+    if (Lowered.getTag(ctx) == TreeLowering::Mod) {
         error = error || (!Types.isErrorTy(lhs) && !Types.isIntegerTy(lhs));
         error = error || (!Types.isErrorTy(rhs) && !Types.isIntegerTy(rhs));
     }
@@ -397,16 +474,17 @@ std::any TypeCheckVisitor::visitArithmetic(AslParser::ArithmeticContext *ctx) {
 
     putTypeDecor(ctx, resultTy);
     putIsLValueDecor(ctx, false);
-    DEBUG_EXIT();
-    return 0;
 }
 
 std::any TypeCheckVisitor::visitRelational(AslParser::RelationalContext *ctx) {
     DEBUG_ENTER();
+    checkBinaryChain(ctx);
+    DEBUG_EXIT();
+    return 0;
+}
 
-    visit(ctx->expr(0));
+void TypeCheckVisitor::checkRelational(AslParser::RelationalContext *ctx) {
     TypesMgr::TypeId t1 = getTypeDecor(ctx->expr(0));
-    visit(ctx->expr(1));
     TypesMgr::TypeId t2 = getTypeDecor(ctx->expr(1));
     std::string oper = ctx->op->getText();
 
@@ -417,15 +495,16 @@ std::any TypeCheckVisitor::visitRelational(AslParser::RelationalContext *ctx) {
     TypesMgr::TypeId t = Types.createBooleanTy();
     putTypeDecor(ctx, t);
     putIsLValueDecor(ctx, false);
-    DEBUG_EXIT();
-    return 0;
 }
 
 std::any TypeCheckVisitor::visitLogical(AslParser::LogicalContext *ctx) {
     DEBUG_ENTER();
-    visit(ctx->expr(0));
-    visit(ctx->expr(1));
+    checkBinaryChain(ctx);
+    DEBUG_EXIT();
+    return 0;
+}
 
+void TypeCheckVisitor::checkLogical(AslParser::LogicalContext *ctx) {
     TypesMgr::TypeId lhs = getTypeDecor(ctx->expr(0));
     TypesMgr::TypeId rhs = getTypeDecor(ctx->expr(1));
 
@@ -435,8 +514,6 @@ std::any TypeCheckVisitor::visitLogical(AslParser::LogicalContext *ctx) {
 
     putTypeDecor(ctx, Types.createBooleanTy());
     putIsLValueDecor(ctx, false);
-    DEBUG_EXIT();
-    return 0;
 }
 
 std::any TypeCheckVisitor::visitValue(AslParser::ValueContext *ctx) {
@@ -509,7 +586,7 @@ std::any TypeCheckVisitor::visitFuncCall(AslParser::FuncCallContext *ctx) {
                 putTypeDecor(ctx, Types.createErrorTy());
             }
 
-            auto &params = Types.getFuncParamsTypes(funcType);
+            auto params = Types.getFuncParamsTypes(funcType);
             if (params.size() != ctx->expr().size())
                 Errors.numberOfParameters(ctx->ident());
 
@@ -560,16 +637,18 @@ std::any TypeCheckVisitor::visitParent(AslParser::ParentContext *ctx) {
 
 std::any TypeCheckVisitor::visitIdent(AslParser::IdentContext *ctx) {
     DEBUG_ENTER();
-    std::string ident = ctx->getText();
-    if (Symbols.findInStack(ident) == -1) {
+    // The identifier is resolved once: the binding is kept in the
+    // node, so the code generation does not look it up again
+    SymTable::Binding binding = Symbols.resolve(currScope, Lowered.getAtom(ctx));
+    putBindingDecor(ctx, binding);
+    if (binding.cls == SymTable::Binding::Undeclared) {
         Errors.undeclaredIdent(ctx->ID());
         TypesMgr::TypeId te = Types.createErrorTy();
         putTypeDecor(ctx, te);
         putIsLValueDecor(ctx, true);
     } else {
-        TypesMgr::TypeId t1 = Symbols.getType(ident);
-        putTypeDecor(ctx, t1);
-        if (Symbols.isFunctionClass(ident))
+        putTypeDecor(ctx, binding.type);
+        if (binding.cls == SymTable::Binding::Function)
             putIsLValueDecor(ctx, false);
         else
             putIsLValueDecor(ctx, true);
@@ -581,28 +660,32 @@ std::any TypeCheckVisitor::visitIdent(AslParser::IdentContext *ctx) {
 // Getters for the necessary tree node atributes:
 //   Scope, Type ans IsLValue
 SymTable::ScopeId
-TypeCheckVisitor::getScopeDecor(antlr4::ParserRuleContext *ctx) {
+TypeCheckVisitor::getScopeDecor(AslRuleContext *ctx) {
     return Decorations.getScope(ctx);
 }
 TypesMgr::TypeId
-TypeCheckVisitor::getTypeDecor(antlr4::ParserRuleContext *ctx) {
+TypeCheckVisitor::getTypeDecor(AslRuleContext *ctx) {
     return Decorations.getType(ctx);
 }
-bool TypeCheckVisitor::getIsLValueDecor(antlr4::ParserRuleContext *ctx) {
+bool TypeCheckVisitor::getIsLValueDecor(AslRuleContext *ctx) {
     return Decorations.getIsLValue(ctx);
 }
 
 // Setters for the necessary tree node attributes:
-//   Scope, Type ans IsLValue
-void TypeCheckVisitor::putScopeDecor(antlr4::ParserRuleContext *ctx,
+//   Scope, Type, IsLValue and Binding
+void TypeCheckVisitor::putScopeDecor(AslRuleContext *ctx,
                                      SymTable::ScopeId s) {
     Decorations.putScope(ctx, s);
 }
-void TypeCheckVisitor::putTypeDecor(antlr4::ParserRuleContext *ctx,
+void TypeCheckVisitor::putTypeDecor(AslRuleContext *ctx,
                                     TypesMgr::TypeId t) {
     Decorations.putType(ctx, t);
 }
-void TypeCheckVisitor::putIsLValueDecor(antlr4::ParserRuleContext *ctx,
+void TypeCheckVisitor::putIsLValueDecor(AslRuleContext *ctx,
                                         bool b) {
     Decorations.putIsLValue(ctx, b);
 }
+void TypeCheckVisitor::putBindingDecor(AslRuleContext *ctx,
+                                       const SymTable::Binding &b) {
+    Decorations.putBinding(ctx, b);
+}
@@ -37,6 +37,8 @@
 #include "../common/TreeDecoration.h"
 #include "../common/TypesMgr.h"
 
+#include "TreeLowering.h"
+
 // using namespace std;
 
 //////////////////////////////////////////////////////////////////////
@@ -50,9 +52,18 @@
 
 class TypeCheckVisitor final : public AslBaseVisitor {
   public:
-    // Constructor
+    // Constructor. The bodies of the functions are checked
+    // concurrently by up to 'jobs' threads, with stacks of stackSize
+    // bytes (0 for the default size)
     TypeCheckVisitor(TypesMgr &Types, SymTable &Symbols,
-                     TreeDecoration &Decorations, SemErrors &Errors);
+                     TreeDecoration &Decorations,
+                     const TreeLowering &Lowered, SemErrors &Errors,
+                     unsigned int jobs = 1, std::size_t stackSize = 0);
+
+    // Check a function on its own (streaming mode). The signatures of
+    // all the functions are already in the global scope
+    void checkFunction(AslParser::FunctionContext *ctx,
+                       SymTable::ScopeId globalScope);
 
     // Methods to visit each kind of node.
     // Non visited nodes have been commented out:
@@ -89,24 +100,40 @@ class TypeCheckVisitor final : public AslBaseVisitor {
     TypesMgr &Types;
     SymTable &Symbols;
     TreeDecoration &Decorations;
+    const TreeLowering &Lowered;
     SemErrors &Errors;
+    // Number of threads that check the function bodies, and the size
+    // of their stacks
+    unsigned int numJobs;
+    std::size_t stackSize;
+    // Current scope, used to look up the symbols without modifying
+    // the stack of scopes of the SymTable (shared by all the workers)
+    SymTable::ScopeId currScope;
     // Current function type (assigned before visit its instructions)
     TypesMgr::TypeId currFunctionType;
 
+    // Check the binary operators (see checkBinaryChain). The operands
+    // have already been checked
+    void checkBinaryChain(AslParser::ExprContext *ctx);
+    void checkArithmetic(AslParser::ArithmeticContext *ctx);
+    void checkRelational(AslParser::RelationalContext *ctx);
+    void checkLogical(AslParser::LogicalContext *ctx);
+
     // Accessor/Mutator to the type (TypeId) of the current function
     TypesMgr::TypeId getCurrentFunctionTy() const;
     void setCurrentFunctionTy(TypesMgr::TypeId type);
 
     // Getters for the necessary tree node atributes:
     //   Scope, Type ans IsLValue
-    SymTable::ScopeId getScopeDecor(antlr4::ParserRuleContext *ctx);
-    TypesMgr::TypeId getTypeDecor(antlr4::ParserRuleContext *ctx);
-    bool getIsLValueDecor(antlr4::ParserRuleContext *ctx);
+    SymTable::ScopeId getScopeDecor(AslRuleContext *ctx);
+    TypesMgr::TypeId getTypeDecor(AslRuleContext *ctx);
+    bool getIsLValueDecor(AslRuleContext *ctx);
 
     // Setters for the necessary tree node attributes:
-    //   Scope, Type ans IsLValue
-    void putScopeDecor(antlr4::ParserRuleContext *ctx, SymTable::ScopeId s);
-    void putTypeDecor(antlr4::ParserRuleContext *ctx, TypesMgr::TypeId t);
-    void putIsLValueDecor(antlr4::ParserRuleContext *ctx, bool b);
+    //   Scope, Type, IsLValue and Binding
+    void putScopeDecor(AslRuleContext *ctx, SymTable::ScopeId s);
+    void putTypeDecor(AslRuleContext *ctx, TypesMgr::TypeId t);
+    void putIsLValueDecor(AslRuleContext *ctx, bool b);
+    void putBindingDecor(AslRuleContext *ctx, const SymTable::Binding &b);
 
 }; // class TypeCheckVisitor
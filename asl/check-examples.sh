@@ -2,6 +2,15 @@
 
 export LD_LIBRARY_PATH=/assig/$USER/cl/runtime/lib:$HOME/assig/cl/runtime/lib:/usr/local/lib
 
+# ./check-examples.sh --golden <asl>: write the golden t-code of the
+# genc examples (examples/*.t) with the given (baseline) compiler
+if (test "$1" == "--golden"); then
+    for f in ../examples/jpbasic_genc_*.asl ../examples/jp_genc_*.asl; do
+	"$2" "$f" >"${f/asl/t}"
+    done
+    exit 0
+fi
+
 #--------------------------------------------
 function check_chkt_example() {
     expected=$1
@@ -59,6 +68,29 @@ done
 echo "=== END examples/jp_chkt_* typecheck =================="
 echo "======================================================="
 
+########### check all 'jp_synt' examples (syntax errors, some of them
+########### after a byte order mark): the position of the first error,
+########### and the same errors with --fastParse (that parses again)
+echo ""
+echo "======================================================="
+echo "=== BEGIN examples/jp_synt_* syntax ==================="
+for f in ../examples/jp_synt_*.asl; do
+    echo -n "****" $(basename "$f") "...."
+    ./asl "$f" >tmp.out 2>&1
+    ./asl --fastParse "$f" >tmp.fast 2>&1
+    grep -o '^line [0-9]*:[0-9]*' tmp.out | head -1 >tmp.err
+    if (diff tmp.out tmp.fast >/dev/null); then
+	check_chkt_example "${f/asl/err}" tmp.err
+    else
+	echo "Wrong output with --fastParse"
+	diff tmp.out tmp.fast
+	echo ""
+    fi
+    rm -f tmp.out tmp.fast tmp.err
+done
+echo "=== END examples/jp_synt_* syntax ====================="
+echo "======================================================="
+
 ########### check all 'jpbasic_genc' examples
 echo ""
 echo "======================================================="
@@ -94,3 +126,109 @@ for f in ../examples/jp_genc_*.asl; do
 done
 echo "=== END examples/jp_genc_* codegen ===================="
 echo "======================================================="
+
+########### check the -O0 t-code of the 'genc' examples against the
+########### golden files (the ';;;' statement lines of the older
+########### compilers are not compared)
+echo ""
+echo "======================================================="
+echo "=== BEGIN examples/*genc_* golden t-code -O0 =========="
+for f in ../examples/jpbasic_genc_*.asl ../examples/jp_genc_*.asl; do
+    echo -n "****" $(basename "$f") "...."
+    if (test ! -f "${f/asl/t}"); then
+	echo "No golden file"
+	continue
+    fi
+    ./asl -O0 "$f" 2>&1 | grep -v '^ *;;;' >tmp.t
+    grep -v '^ *;;;' "${f/asl/t}" >tmp.golden
+    check_genc_example tmp.golden tmp.t
+    rm -f tmp.t tmp.golden
+done
+echo "=== END examples/*genc_* golden t-code -O0 ============"
+echo "======================================================="
+
+########### check that the optimized code of all 'genc' examples can
+########### be translated to LLVM IR (and run it, if clang is found)
+echo ""
+echo "======================================================="
+echo "=== BEGIN examples/*genc_* LLVM IR -O2 ================"
+for f in ../examples/jpbasic_genc_*.asl ../examples/jp_genc_*.asl; do
+    name=$(basename "$f" .asl)
+    echo -n "****" $(basename "$f") "...."
+    rm -f "$name.ll"
+    ./asl -O2 --genLLVM "$f" >tmp.t 2>&1
+    if (test $? != 0 -o ! -f "$name.ll"); then
+	echo "Compilation errors"
+    elif (which clang >/dev/null 2>&1); then
+	clang -Wno-override-module -o tmp.exe "$name.ll" >/dev/null 2>&1 &&
+	    ./tmp.exe < "${f/asl/in}" >tmp.out
+	check_genc_example "${f/asl/out}" tmp.out
+    else
+	echo "OK"
+    fi
+    rm -f "$name.ll" tmp.t tmp.exe tmp.out
+done
+echo "=== END examples/*genc_* LLVM IR -O2 =================="
+echo "======================================================="
+
+########### check all 'genc' examples through the optimization
+########### pipelines, the streaming mode and the resident server
+# run the genc examples compiled with ./asl $@ <file.asl>
+function check_genc_examples() {
+    for f in ../examples/jpbasic_genc_*.asl ../examples/jp_genc_*.asl; do
+	echo -n "****" $(basename "$f") "...."
+	./asl "$@" "$f" >tmp.t 2>&1
+	if (test $? != 0); then
+	    echo "Compilation errors"
+	else
+	    ../tvm/tvm tmp.t < "${f/asl/in}" >tmp.out
+	    check_genc_example "${f/asl/out}" tmp.out
+	fi
+	rm -f tmp.t tmp.out tmp.diff
+    done
+}
+
+for options in "-O1" "-O2" "--stream -O2"; do
+    echo ""
+    echo "======================================================="
+    echo "=== BEGIN examples/*genc_* codegen $options"
+    check_genc_examples $options
+    echo "=== END examples/*genc_* codegen $options"
+    echo "======================================================="
+done
+
+echo ""
+echo "======================================================="
+echo "=== BEGIN examples/*genc_* codegen -j 4 -O2 ==========="
+./asl -j 4 -O2 ../examples/jpbasic_genc_*.asl ../examples/jp_genc_*.asl >tmp.err 2>&1
+for f in ../examples/jpbasic_genc_*.asl ../examples/jp_genc_*.asl; do
+    name=$(basename "$f" .asl)
+    echo -n "****" $(basename "$f") "...."
+    if (test ! -f "$name.t"); then
+	echo "Compilation errors"
+    else
+	../tvm/tvm "$name.t" < "${f/asl/in}" >tmp.out
+	check_genc_example "${f/asl/out}" tmp.out
+    fi
+    rm -f "$name.t" tmp.out tmp.diff
+done
+rm -f tmp.err
+echo "=== END examples/*genc_* codegen -j 4 -O2 ============="
+echo "======================================================="
+
+echo ""
+echo "======================================================="
+echo "=== BEGIN examples/*genc_* codegen --client -O1 ======="
+socket=/tmp/asl-check-$$.sock
+./asl --server=$socket 2>/dev/null &
+server=$!
+# the client compiles by itself if the server is not listening yet
+for i in $(seq 50); do
+    if (test -S $socket); then break; fi
+    sleep 0.1
+done
+check_genc_examples --client=$socket -O1
+kill $server
+rm -f $socket
+echo "=== END examples/*genc_* codegen --client -O1 ========="
+echo "======================================================="
@@ -31,22 +31,21 @@
 
 
 #include "antlr4-runtime.h"
-#include "AslLexer.h"
-#include "AslParser.h"
-
-#include "../common/TypesMgr.h"
-#include "../common/SymTable.h"
-#include "../common/TreeDecoration.h"
-#include "../common/SemErrors.h"
-#include "SymbolsVisitor.h"
-#include "TypeCheckVisitor.h"
-#include "../common/code.h"
-#include "CodeGenVisitor.h"
+
+#include "../common/MappedCharStream.h"
+#include "Driver.h"
+#include "Server.h"
+#include "Batch.h"
+#include "Client.h"
 
 #include <iostream>
-#include <fstream>    // ifstream
+#include <fstream>    // ofstream
+#include <iterator>   // istreambuf_iterator
+#include <string>
+#include <vector>
+#include <thread>     // hardware_concurrency
 
-#include <cstdio>     // fopen
+#include <cstdio>     // fopen, remove
 #include <cstdlib>    // EXIT_FAILURE, EXIT_SUCCESS
 #include <cstring>    // strcmp
 
@@ -54,113 +53,124 @@
 // using namespace antlr4;
 
 
+namespace {
+
+void printUsage() {
+  std::cout << "Usage: ./asl [<options>] [<file.asl>]" << std::endl;
+  std::cout << "       ./asl [<options>] -j N <file.asl>..." << std::endl;
+  std::cout << "         (writes the code of each file.asl to file.t/file.ll, even for one file)" << std::endl;
+  std::cout << "       ./asl --server[=<socket path>]" << std::endl;
+  std::cout << "       ./asl --client=<socket path> [<options>] [<file.asl>]" << std::endl;
+  std::cout << "Options: --noTypecheck --noCodegen --genLLVM --typecheckJobs=N --codegenJobs=N" << std::endl;
+  std::cout << "         --fastParse --parseStats --sourceComments --stream --stackSize=MB" << std::endl;
+  std::cout << "         -O0 -O1 -O2 --passes=name,... --passStats" << std::endl;
+}
+
+// The number of jobs of -j: a positive decimal number
+bool parseJobs(const std::string & text, unsigned int & jobs) {
+  if (text.empty() or text.size() > 6 or
+      text.find_first_not_of("0123456789") != std::string::npos)
+    return false;
+  jobs = std::stoul(text);
+  return jobs > 0;
+}
+
+}  // namespace
+
+
 int main(int argc, const char* argv[]) {
 
-  bool doTypeCheck=true, doCodeGen=true, doLLVM=false;
-  std::string filename;
+  CompilerOptions options;
+  std::vector<std::string> optionWords;
+  std::vector<std::string> filenames;
+  unsigned int jobs = 0;
+  bool parseStats = false;
+  std::string clientSocket;
   for (int i=1; i<argc; ++i) {
-    if (std::string(argv[i]) == "--noTypecheck") doTypeCheck=false;
-    else if (std::string(argv[i]) == "--noCodegen") doCodeGen=false;
-    else if (std::string(argv[i]) == "--genLLVM") doLLVM=true;
-    else if (filename=="") {
-      // it is not a valid option, must be the file name, make sure it is the first one
-      filename = std::string(argv[i]);
+    std::string arg(argv[i]);
+    if (options.parseOption(arg)) optionWords.push_back(arg);
+    else if (arg == "--parseStats") parseStats = true;
+    else if (arg.rfind("--client=", 0) == 0) clientSocket = arg.substr(9);
+    else if (arg == "--server") return runServer("");
+    else if (arg.rfind("--server=", 0) == 0) return runServer(arg.substr(9));
+    else if (arg == "-j" and i+1 < argc) {
+      if (not parseJobs(argv[++i], jobs)) { printUsage(); return EXIT_FAILURE; }
     }
-    else { // something unexpected came: Not a valid option, and a second filename
-      std::cout << "Usage: ./asl [--noTypecheck|--noCodegen|--genLLVM] [<file.asl>]" << std::endl;
+    else if (arg.rfind("-j", 0) == 0 and arg.size() > 2) {
+      if (not parseJobs(arg.substr(2), jobs)) { printUsage(); return EXIT_FAILURE; }
+    }
+    else if (arg.rfind("-", 0) == 0 and arg.size() > 1) {
+      // something unexpected came: Not a valid option
+      printUsage();
       return EXIT_FAILURE;
     }
+    else filenames.push_back(arg);
+  }
+
+  // several files (or -j): compile them in parallel, writing the
+  // generated code of each one to its own .t/.ll file
+  if (jobs > 0 and filenames.empty()) {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+  if (filenames.size() > 1 or jobs > 0) {
+    if (jobs == 0) jobs = std::thread::hardware_concurrency();
+    int status = compileFiles(filenames, options, jobs);
+    if (parseStats) printParseStatistics(std::cerr);
+    return status;
+  }
+  std::string filename = filenames.empty() ? "" : filenames[0];
+
+  // with --client the program is compiled by a resident server, if it
+  // can be reached (if not, it is compiled here). The parse statistics
+  // of the server are those of all its requests, so --parseStats is
+  // not accepted (the server answers a 'stats' request with them)
+  std::string source;
+  if (clientSocket != "" and parseStats) {
+    std::cout << "--parseStats can not be used with --client" << std::endl;
+    printUsage();
+    return EXIT_FAILURE;
+  }
+  if (clientSocket != "") {
+    if (filename == "")
+      source.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    int status = compileOnServer(clientSocket, optionWords, filename, source, options.doLLVM);
+    if (status != NoServer)
+      return status;
   }
   
   // open input file (or std::cin) and create a character stream
-  antlr4::ANTLRInputStream input;
+  MappedCharStream input;
   if (filename != "") {
-    std::ifstream stream;
-    stream.open(filename);
-    if (stream.fail()) {
+    if (not input.open(filename)) {
       std::cout << "Could not open file: " << filename << std::endl;
       return EXIT_FAILURE;
     }
-    input = antlr4::ANTLRInputStream(stream);
   }
-  else {            // read fron std::cin
-    input = antlr4::ANTLRInputStream(std::cin);
+  else if (clientSocket != "") {  // already read from std::cin
+    input.load(std::move(source));
   }
-  
-  // create a lexer that consumes the character stream and produces a token stream
-  AslLexer lexer(&input);
-  antlr4::CommonTokenStream tokens(&lexer);
-  
-  // create a parser that consumes the token stream, and parses it.
-  AslParser parser(&tokens);
-  
-  // call the parser and get the parse tree
-  antlr4::tree::ParseTree *tree = parser.program();
-  
-  // check for lexical or syntactical errors
-  if (lexer.getNumberOfSyntaxErrors() > 0 or
-      parser.getNumberOfSyntaxErrors() > 0) {
-    std::cout << "Lexical and/or syntactical errors have been found." << std::endl;
-    return EXIT_FAILURE;
-  }
-  
-  // print the parse tree (for debugging purposes)
-  // std::cout << tree->toStringTree(&parser) << std::endl;
-  
-  if (not doTypeCheck) {
-    std::cout << "-- Early stop: no typecheck has been made." << std::endl;
-    return EXIT_SUCCESS;
-  }
-  
-  // auxililary classes we are going to need to store information while
-  // traversing the tree. They are described below in this document
-  TypesMgr       types;
-  SymTable       symbols(types);
-  TreeDecoration decorations;
-  SemErrors      errors;
-
-  // create a visitor that looks for variables and function declarations
-  // in the tree and stores required information
-  SymbolsVisitor symboldecl(types, symbols, decorations, errors);
-  symboldecl.visit(tree);
-
-  // create another visitor that will perform type checkings wherever
-  // it is needed (on expressions, assignments, parameter passing, etc)
-  TypeCheckVisitor typecheck(types, symbols, decorations, errors);
-  typecheck.visit(tree);
-
-  if (errors.getNumberOfSemanticErrors() > 0) {
-    std::cout << "There are semantic errors: no code generated." << std::endl;
-    return EXIT_FAILURE;
+  else {            // read fron std::cin
+    input.load(std::cin);
   }
 
-  if (not doCodeGen) {
-    std::cout << "-- Early stop: no code generated." << std::endl;
-    return EXIT_SUCCESS;
-  }
-  
-  // create a third visitor that will return the generated code
-  // for each part of the tree, and will store it in 'mycode'
-  CodeGenVisitor codegenerator(types, symbols, decorations);
-  code mycode = std::any_cast<code>(codegenerator.visit(tree));
+  // parse, check and translate the program (t-code goes to std::cout,
+  // and the LLVM IR is streamed to the .ll file)
+  std::string llvmFileName = outputFileName(filename, ".ll");
+  std::ofstream myLLVMFile;
+  if (options.doLLVM)
+    myLLVMFile.open(llvmFileName, std::ofstream::out);
+  int status = compile(input, options, std::cout, std::cout, std::cerr,
+                       options.doLLVM ? &myLLVMFile : nullptr);
+  if (parseStats) printParseStatistics(std::cerr);
+  if (not options.doLLVM)
+    return status;
 
-  // print generated code as output
-  std::cout << mycode.dump() << std::endl;
-  
-  if (doLLVM) {
-    std::string llvmStr = mycode.dumpLLVM(types, symbols);
-    std::string llvmFileName;
-    if (filename == "") 
-      llvmFileName = "output.ll";
-    else {
-      std::size_t slashPos = filename.rfind("/");
-      std::size_t dotPos   = filename.rfind(".");
-      llvmFileName = filename.substr(slashPos+1, dotPos-slashPos-1) + ".ll";
-    }
-    std::ofstream myLLVMFile(llvmFileName, std::ofstream::out);
-    myLLVMFile << llvmStr << std::endl;
-    myLLVMFile.close();
-  }
-  
-  return EXIT_SUCCESS;
+  // keep the .ll file only if the whole IR has been written
+  bool llvmDone = status == EXIT_SUCCESS and myLLVMFile.tellp() > 0;
+  if (llvmDone) myLLVMFile << std::endl;
+  myLLVMFile.close();
+  if (not llvmDone) std::remove(llvmFileName.c_str());
+
+  return status;
 }
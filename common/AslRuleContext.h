@@ -0,0 +1,58 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    AslRuleContext - Base class of the parse tree nodes
+//                     of the Asl programming language
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "antlr4-runtime.h"
+
+#include <cstddef>
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class AslRuleContext: all the contexts generated by the antlr4
+// parser for the Asl grammar derive from this class (see the option
+// contextSuperClass in Asl.g4). Once the tree has been built, the
+// TreeDecoration gives each node a number (decorIndex) that is used
+// to access its attributes in constant time.
+
+class AslRuleContext : public antlr4::ParserRuleContext {
+
+public:
+  AslRuleContext() = default;
+  AslRuleContext(antlr4::ParserRuleContext *parent, size_t invokingStateNumber)
+    : antlr4::ParserRuleContext(parent, invokingStateNumber) { }
+
+  // Number of the node given by the TreeDecoration
+  std::size_t decorIndex = NoIndex;
+
+  static constexpr std::size_t NoIndex = std::size_t(-1);
+
+};  // class AslRuleContext
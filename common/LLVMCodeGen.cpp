@@ -33,6 +33,8 @@
 #include "code.h"
 
 #include <string>
+#include <sstream>
+#include <cstdlib>       // EXIT_SUCCESS, EXIT_FAILURE
 #include <cctype>
 // uncomment to disable assert()
 // #define NDEBUG
@@ -105,8 +107,18 @@ const std::map<instruction::Operation, std::string> LLVMCodeGen::tcode2llvmInstr
 };
 
 
-LLVMCodeGen::LLVMCodeGen(const TypesMgr & Types, const SymTable & Symbols, const code & tCode)
-  : Types{Types}, Symbols{Symbols}, tCode{tCode},
+LLVMCodeGenError::LLVMCodeGenError(const std::string &message, int status)
+  : std::runtime_error{message}, status{status} {
+}
+
+int LLVMCodeGenError::getStatus() const {
+  return status;
+}
+
+
+LLVMCodeGen::LLVMCodeGen(const TypesMgr & Types, const SymTable & Symbols, const code & tCode,
+                         bool sourceComments)
+  : Types{Types}, Symbols{Symbols}, tCode{tCode}, sourceComments{sourceComments},
     writeI(false), writeF(false), writeC(false), writeLN(false),
     readI(false), readF(false), readC(false),
     haltAndExit(false),
@@ -115,16 +127,17 @@ LLVMCodeGen::LLVMCodeGen(const TypesMgr & Types, const SymTable & Symbols, const
   std::string failFunc, failTempVar;
   check_SSA_tCode(failFunc, failTempVar);
   if (failFunc != "") {
-    std::cerr << std::endl;
-    std::cerr << ";;; *****************************************************************************" << std::endl;
-    std::cerr << ";;; WARNING: in order to generate LLVM code, this emitter impose the following"    << std::endl;
-    std::cerr << ";;;          restriction: the temporal variables in the t-code cannot be multiply" << std::endl;
-    std::cerr << ";;;          defined inside a function."                                           << std::endl;
-    std::cerr << ";;;          For example, this happens in function '";
-    std::cerr << failFunc << "' with temporal '" << failTempVar << "'"       << std::endl;
-    std::cerr << ";;; *****************************************************************************" << std::endl;
-    std::cerr << std::endl;
-    std::exit(EXIT_SUCCESS);
+    std::ostringstream msg;
+    msg << std::endl;
+    msg << ";;; *****************************************************************************" << std::endl;
+    msg << ";;; WARNING: in order to generate LLVM code, this emitter impose the following"    << std::endl;
+    msg << ";;;          restriction: the temporal variables in the t-code cannot be multiply" << std::endl;
+    msg << ";;;          defined inside a function."                                           << std::endl;
+    msg << ";;;          For example, this happens in function '";
+    msg << failFunc << "' with temporal '" << failTempVar << "'"       << std::endl;
+    msg << ";;; *****************************************************************************" << std::endl;
+    msg << std::endl;
+    throw LLVMCodeGenError(msg.str(), EXIT_SUCCESS);
   }
 }
 
@@ -153,7 +166,7 @@ void LLVMCodeGen::check_SSA_tCode(std::string & failFunc, std::string & failTemp
         break;
       default:                 // Except in instruction::_POP, where is optional (arg1 may be ""),
                                // the argument arg1 always does exist.
-        std::string arg1 = getTCodeArg(instr, 1);
+        std::string arg1 = getTCodeArg(subr, instr, 1);
         if (isTCodeTemporal(arg1)) {
           modTempCounts[arg1] += 1;
         }
@@ -190,9 +203,9 @@ bool LLVMCodeGen::isTCodeIdentifier(const std::string & tcodeArg) const {
 void LLVMCodeGen::computeReadWriteHaltInfo() {
   for (auto & subr: tCode.get_subroutine_list()) {
     for (auto & instr: subr.get_instructions()) {
-      std::string arg1 = getTCodeArg(instr, 1);
-      std::string arg2 = getTCodeArg(instr, 2);
-      std::string arg3 = getTCodeArg(instr, 3);
+      std::string arg1 = getTCodeArg(subr, instr, 1);
+      std::string arg2 = getTCodeArg(subr, instr, 2);
+      std::string arg3 = getTCodeArg(subr, instr, 3);
       switch (instr.oper) {
       case instruction::_WRITEI:
         writeI = true;
@@ -261,9 +274,9 @@ void LLVMCodeGen::bindTCodeLocalSymbolsToLLVMTypes(const subroutine & subr) {
     bindTCodeLocalValueWithType(varlocal.name, llvmType);
   }
   for (auto instr : subr.get_instructions()) {
-    std::string arg1 = getTCodeArg(instr, 1);
-    std::string arg2 = getTCodeArg(instr, 2);
-    std::string arg3 = getTCodeArg(instr, 3);
+    std::string arg1 = getTCodeArg(subr, instr, 1);
+    std::string arg2 = getTCodeArg(subr, instr, 2);
+    std::string arg3 = getTCodeArg(subr, instr, 3);
     switch (instr.oper) {
     case instruction::_LABEL:
       {
@@ -553,13 +566,14 @@ void LLVMCodeGen::bindTCodeLocalSymbolsToLLVMTypes(const subroutine & subr) {
     }
   }
   if (errors) {
-    std::cerr << "ERROR: some local values of this function can not been binded to a valid type:" << std::endl;
-    std::cerr << "++++++++++++++++++++++++++++++++ function: " << funcName << std::endl;
+    std::ostringstream msg;
+    msg << "ERROR: some local values of this function can not been binded to a valid type:" << std::endl;
+    msg << "++++++++++++++++++++++++++++++++ function: " << funcName << std::endl;
     for (auto & value : llvmLocalValueVec) {
-      std::cerr << value << ": \t" << llvmLocalValueTypeMap.at(value) << std::endl;
+      msg << value << ": \t" << llvmLocalValueTypeMap.at(value) << std::endl;
     }
-    std::cerr << "--------------------------------" << std::endl;
-    std::exit(EXIT_FAILURE);
+    msg << "--------------------------------" << std::endl;
+    throw LLVMCodeGenError(msg.str(), EXIT_FAILURE);
   }
   for (auto & llvmValue : llvmLocalValueVec) {
     std::string llvmType = llvmLocalValueTypeMap.at(llvmValue);
@@ -695,39 +709,49 @@ void LLVMCodeGen::generateReadWriteHaltBeginEndCode(std::string & begin, std::st
 }
 
 std::string LLVMCodeGen::dumpLLVM() {
-  std::string llvmCode, llvmBegin, llvmEnd;
+  std::ostringstream llvmCode;
+  dumpLLVM(llvmCode);
+  return llvmCode.str();
+}
+
+// The prologue (format strings, globals) and the epilogue (declares)
+// come from a pre-scan of the t-code, so the functions can be written
+// to os as soon as each one is translated. The IR of a function is
+// built in a buffer that is reused for all of them.
+void LLVMCodeGen::dumpLLVM(std::ostream & os) {
+  std::string llvmBegin, llvmEnd;
   generateReadWriteHaltBeginEndCode(llvmBegin, llvmEnd);
   bindGlobalValuesWithTypes();
+  os << llvmBegin;
+  std::string llvmCode;
   for (auto & subr: tCode.get_subroutine_list()) {
     bindTCodeLocalSymbolsToLLVMTypes(subr);
     startNewFunction(subr);
-    llvmCode += dumpSubroutine(subr);
+    llvmCode.clear();
+    dumpSubroutine(subr, llvmCode);
+    os.write(llvmCode.data(), llvmCode.size());
   }
-  llvmCode = llvmBegin + llvmCode + llvmEnd;
-  return llvmCode;
+  os << llvmEnd;
 }
 
-std::string LLVMCodeGen::dumpSubroutine(const subroutine & subr) {
-  std::string llvmCode;
-  llvmCode += dumpHeader(subr);
+void LLVMCodeGen::dumpSubroutine(const subroutine & subr, std::string & llvmCode) {
+  dumpHeader(subr, llvmCode);
   llvmCode += "{\n";
   llvmCode += llvmComment("   ENTRY label:");
   bindLLVMLocalValueWithType(LLVM_ENTRY, LLVM_LABEL);
   llvmCode += createLABEL(LLVM_ENTRY);
   llvmCode += llvmComment("   --------------------- alloca params:");
-  llvmCode += dumpAllocaParams(subr);
+  dumpAllocaParams(subr, llvmCode);
   llvmCode += llvmComment("   --------------------- alloca local vars:");
-  llvmCode += dumpAllocaLocalVars(subr);
+  dumpAllocaLocalVars(subr, llvmCode);
   llvmCode += llvmComment("   --------------------- store params:");
-  llvmCode += dumpStoreParams(subr);
+  dumpStoreParams(subr, llvmCode);
   llvmCode += llvmComment("   --------------------- instructions:");
-  llvmCode += dumpInstructionList(subr);
+  dumpInstructionList(subr, llvmCode);
   llvmCode += "}\n\n";
-  return llvmCode;
 }
 
-std::string LLVMCodeGen::dumpHeader(const subroutine & subr) {
-  std::string llvmCode;
+void LLVMCodeGen::dumpHeader(const subroutine & subr, std::string & llvmCode) {
   llvmCode += "define dso_local ";
   std::string funcName = subr.get_name();
   if (funcName == "main") {
@@ -747,11 +771,9 @@ std::string LLVMCodeGen::dumpHeader(const subroutine & subr) {
     }
     llvmCode += ") ";
   }
-  return llvmCode;
 }
 
-std::string LLVMCodeGen::dumpAllocaParams(const subroutine & subr) {
-  std::string llvmCode;
+void LLVMCodeGen::dumpAllocaParams(const subroutine & subr, std::string & llvmCode) {
   std::string funcName = subr.get_name();
   for (auto p : subr.params) {
     std::string llvmValue = getLLVMValue(p.name);
@@ -766,11 +788,9 @@ std::string LLVMCodeGen::dumpAllocaParams(const subroutine & subr) {
     llvmCode += llvmComment("   param " + p.name + " " + llvmType);
     llvmCode += createALLOCA(llvmValueAddr, llvmType);
   }
-  return llvmCode;
 }
 
-std::string LLVMCodeGen::dumpAllocaLocalVars(const subroutine & subr) {
-  std::string llvmCode;
+void LLVMCodeGen::dumpAllocaLocalVars(const subroutine & subr, std::string & llvmCode) {
   std::string funcName = subr.get_name();
   for (auto v : subr.vars) {
     std::string llvmValue     = getLLVMValue(v.name);
@@ -781,11 +801,9 @@ std::string LLVMCodeGen::dumpAllocaLocalVars(const subroutine & subr) {
     llvmCode += llvmComment("   localVar " + v.name +  " " + llvmType);
     llvmCode += createALLOCA(llvmValueAddr, llvmType);
   }
-  return llvmCode;
 }
 
-std::string LLVMCodeGen::dumpStoreParams(const subroutine & subr) {
-  std::string llvmCode;
+void LLVMCodeGen::dumpStoreParams(const subroutine & subr, std::string & llvmCode) {
   std::string funcName = subr.get_name();
   if (funcName == "main") {
     // std::string llvmValue     = getLLVMValue("_result");
@@ -806,33 +824,35 @@ std::string LLVMCodeGen::dumpStoreParams(const subroutine & subr) {
       llvmCode += createSTORE(llvmValue, llvmValueAddr);
     }
   }
-  return llvmCode;
 }
 
-std::string LLVMCodeGen::dumpInstructionList(const subroutine & subr) {
-  std::string llvmCode;
+void LLVMCodeGen::dumpInstructionList(const subroutine & subr, std::string & llvmCode) {
   int n = subr.get_instructions().size();
-  instructionList instrList = subr.get_instructions();
-  for (int i = 0; i < n-1; ++i) {
-    llvmCode += llvmComment(instrList[i].dump());
-    llvmCode += dumpInstruction(instrList[i], instrList[i+1]);
+  const instructionList &instrList = subr.get_instructions();
+  sourcePos prev;
+  for (int i = 0; i < n; ++i) {
+    sourcePos pos = subr.get_source_position(i);
+    if (sourceComments and pos.line != 0 and
+        (pos.line != prev.line or pos.column != prev.column))
+      llvmCode += ";   line " + std::to_string(pos.line) + ":" + std::to_string(pos.column) + "\n";
+    prev = pos;
+    if (COMMENTS_ENABLED)
+      llvmCode += llvmComment(instrList[i].dump(subr.get_spellings()));
+    dumpInstruction(subr, instrList[i], i < n-1 ? instrList[i+1] : instruction::NOOP(), llvmCode);
   }
-  llvmCode += llvmComment(instrList[n-1].dump());
-  llvmCode += dumpInstruction(instrList[n-1], instruction::NOOP());
-  return llvmCode;
 }
 
 
-std::string LLVMCodeGen::dumpInstruction(const instruction & instr,
-                                         const instruction & next) {
-  std::string llvmCode;
-
+void LLVMCodeGen::dumpInstruction(const subroutine & subr,
+                                  const instruction & instr,
+                                  const instruction & next,
+                                  std::string & llvmCode) {
   std::string llvmValue1, llvmValue2, llvmValue3;
   std::string llvmMemCodeValue1, llvmMemCodeValue2, llvmMemCodeValue3;
 
-  std::string tcodeArg1 = getTCodeArg(instr, 1);
-  std::string tcodeArg2 = getTCodeArg(instr, 2);
-  std::string tcodeArg3 = getTCodeArg(instr, 3);
+  std::string tcodeArg1 = getTCodeArg(subr, instr, 1);
+  std::string tcodeArg2 = getTCodeArg(subr, instr, 2);
+  std::string tcodeArg3 = getTCodeArg(subr, instr, 3);
 
   switch (instr.oper) {
   case instruction::_LABEL:
@@ -868,7 +888,7 @@ std::string LLVMCodeGen::dumpInstruction(const instruction & instr,
         llvmCode += createLABEL(labelContName);
       }
       else {
-        std::string labelCont = getLLVMValue(next.arg1);
+        std::string labelCont = getLLVMValue(subr.get_spellings().str(next.arg1));
         llvmCode += createBR(llvmValue1, labelCont, labelJump);
       }
       break;
@@ -1316,19 +1336,18 @@ std::string LLVMCodeGen::dumpInstruction(const instruction & instr,
   prevInstrIsTerminator = (instr.oper == instruction::_UJUMP or
                            instr.oper == instruction::_FJUMP or
                            instr.oper == instruction::_RETURN);
-  
-  return llvmCode;
 }
 
 
-std::string LLVMCodeGen::getTCodeArg(const instruction & instr, int i) const {
+std::string LLVMCodeGen::getTCodeArg(const subroutine & subr,
+                                     const instruction & instr, int i) const {
   std::string arg;
   if (i == 1)
-    arg = instr.arg1;
+    arg = subr.get_spellings().str(instr.arg1);
   else if (i == 2)
-    arg = instr.arg2;
+    arg = subr.get_spellings().str(instr.arg2);
   else     // i == 3
-    arg = instr.arg3;
+    arg = subr.get_spellings().str(instr.arg3);
   return arg;
 }
 
@@ -35,10 +35,26 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <iosfwd>
 #include <stack>
+#include <stdexcept>
 
 // using namespace std;
 
+////////////////////////////////////////////////////////////////////
+/// Class LLVMCodeGenError is thrown when the t-code can not be
+/// translated into LLVM IR. The message is the report that has to be
+/// written to the error output, and status is the exit code the
+/// compiler has to finish with.
+
+class LLVMCodeGenError : public std::runtime_error {
+public:
+  LLVMCodeGenError(const std::string &message, int status);
+  int getStatus() const;
+private:
+  int status;
+};
+
 class code;
 class subroutine;
 class instruction;
@@ -48,6 +64,7 @@ class LLVMCodeGen {
   const TypesMgr & Types;
   const SymTable & Symbols;
   const code     & tCode;
+  bool             sourceComments;
   
   static const bool COMMENTS_ENABLED;
   static const std::string INDENT_INSTR;
@@ -124,15 +141,19 @@ class LLVMCodeGen {
   void generateReadWriteHaltBeginEndCode(std::string & begin, std::string & end) ;
   void startNewFunction(const subroutine & subr);
   void bindTCodeLocalSymbolsToLLVMTypes(const subroutine & subr);
-  std::string dumpSubroutine(const subroutine & subr);
-  std::string dumpHeader(const subroutine & subr);
-  std::string dumpAllocaParams(const subroutine & subr);
-  std::string dumpAllocaLocalVars(const subroutine & subr);
-  std::string dumpStoreParams(const subroutine & subr);
-  std::string dumpInstructionList(const subroutine & subr);
-  std::string dumpInstruction(const instruction & instr,
-                              const instruction & next);
-  std::string getTCodeArg(const instruction & intr, int i) const;
+  // the dump* methods append the IR to llvmCode
+  void dumpSubroutine(const subroutine & subr, std::string & llvmCode);
+  void dumpHeader(const subroutine & subr, std::string & llvmCode);
+  void dumpAllocaParams(const subroutine & subr, std::string & llvmCode);
+  void dumpAllocaLocalVars(const subroutine & subr, std::string & llvmCode);
+  void dumpStoreParams(const subroutine & subr, std::string & llvmCode);
+  void dumpInstructionList(const subroutine & subr, std::string & llvmCode);
+  void dumpInstruction(const subroutine & subr,
+                       const instruction & instr,
+                       const instruction & next,
+                       std::string & llvmCode);
+  std::string getTCodeArg(const subroutine & subr,
+                          const instruction & intr, int i) const;
   std::string getLLVMValue(const std::string & tcodeIdent) const;
   std::string getLLVMValueAddr(const std::string & llvmValue) const;
 
@@ -207,6 +228,11 @@ class LLVMCodeGen {
   std::string llvmComment(const std::string & comm) const;
 
 public:
-  LLVMCodeGen(const TypesMgr & Types, const SymTable & Symbols, const code & tCode);
+  // With sourceComments the IR of each statement is preceded by a
+  // comment with its position in the source program
+  LLVMCodeGen(const TypesMgr & Types, const SymTable & Symbols, const code & tCode,
+              bool sourceComments = false);
   std::string dumpLLVM();
+  // write the IR to os, function by function
+  void dumpLLVM(std::ostream & os);
 };
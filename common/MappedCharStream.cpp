@@ -0,0 +1,225 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    MappedCharStream - Character stream for the lexer that reads
+//                       the source file through mmap
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "MappedCharStream.h"
+
+#include "antlr4-runtime.h"
+
+#include <string>
+#include <fstream>
+#include <iterator>   // istreambuf_iterator
+#include <algorithm>  // min
+
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+
+// using namespace std;
+
+
+MappedCharStream::MappedCharStream()
+  : data{nullptr}, length{0}, p{0}, first{0}, from{0}, limit{0}, mapped{nullptr} {
+}
+
+MappedCharStream::~MappedCharStream() {
+  close();
+}
+
+void MappedCharStream::close() {
+  if (mapped != nullptr)
+    ::munmap(mapped, length);
+  mapped = nullptr;
+  buffer.clear();
+  data = nullptr;
+  length = p = first = from = limit = 0;
+}
+
+bool MappedCharStream::open(const std::string & filename) {
+  close();
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (::fstat(fd, &st) == 0 and S_ISREG(st.st_mode) and st.st_size > 0) {
+    void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      ::madvise(addr, st.st_size, MADV_SEQUENTIAL);
+      ::close(fd);
+      mapped = addr;
+      data   = static_cast<const unsigned char *>(addr);
+      length = st.st_size;
+      name   = filename;
+      // skip the UTF-8 byte order mark (as ANTLRInputStream does)
+      if (length >= 3 and data[0] == 0xEF and data[1] == 0xBB and data[2] == 0xBF)
+        p = first = from = 3;
+      limit = length;
+      return true;
+    }
+  }
+  ::close(fd);
+  // not a regular file (or empty, or it can not be mapped): read it
+  std::ifstream stream(filename);
+  if (stream.fail())
+    return false;
+  load(stream);
+  name = filename;
+  return true;
+}
+
+void MappedCharStream::load(std::istream & stream) {
+  load(std::string(std::istreambuf_iterator<char>(stream),
+                   std::istreambuf_iterator<char>()));
+}
+
+void MappedCharStream::load(std::string && text) {
+  close();
+  buffer = std::move(text);
+  data   = reinterpret_cast<const unsigned char *>(buffer.data());
+  length = buffer.size();
+  if (length >= 3 and data[0] == 0xEF and data[1] == 0xBB and data[2] == 0xBF)
+    p = first = from = 3;
+  limit = length;
+}
+
+void MappedCharStream::setWindow(std::size_t begin, std::size_t end) {
+  limit = std::min(end, length);
+  p = from = std::min(std::max(begin, first), limit);
+}
+
+void MappedCharStream::resetWindow() {
+  setWindow(first, length);
+}
+
+std::size_t MappedCharStream::start() const {
+  return first;
+}
+
+std::size_t MappedCharStream::sequenceLength(std::size_t pos) const {
+  unsigned char lead = data[pos];
+  std::size_t n;
+  if      (lead < 0x80)         return 1;
+  else if ((lead >> 5) == 0x06) n = 2;
+  else if ((lead >> 4) == 0x0E) n = 3;
+  else if ((lead >> 3) == 0x1E) n = 4;
+  else                          return 1;
+  if (pos + n > length)
+    return 1;
+  for (std::size_t k = 1; k < n; ++k)
+    if ((data[pos + k] & 0xC0) != 0x80)
+      return 1;
+  return n;
+}
+
+std::size_t MappedCharStream::decode(std::size_t pos) const {
+  std::size_t n = sequenceLength(pos);
+  unsigned char lead = data[pos];
+  if (n == 1)
+    return lead < 0x80 ? lead : 0xFFFD;  // invalid sequences: replacement char
+  std::size_t cp = lead & (0x7F >> n);
+  for (std::size_t k = 1; k < n; ++k)
+    cp = (cp << 6) | (data[pos + k] & 0x3F);
+  return cp;
+}
+
+void MappedCharStream::consume() {
+  if (p >= limit)
+    throw antlr4::IllegalStateException("cannot consume EOF");
+  p += sequenceLength(p);
+}
+
+std::size_t MappedCharStream::LA(ssize_t i) {
+  if (i == 0)
+    return 0;  // undefined
+  std::size_t pos = p;
+  if (i > 0) {
+    for (ssize_t k = 1; k < i; ++k) {
+      if (pos >= limit)
+        return IntStream::EOF;
+      pos += sequenceLength(pos);
+    }
+    if (pos >= limit)
+      return IntStream::EOF;
+  }
+  else {
+    for (ssize_t k = 0; k < -i; ++k) {
+      if (pos <= from)
+        return IntStream::EOF;  // invalid: before the first char
+      std::size_t end = pos--;
+      while (pos > 0 and (data[pos] & 0xC0) == 0x80 and end - pos < 4)
+        --pos;
+    }
+  }
+  return decode(pos);
+}
+
+ssize_t MappedCharStream::mark() {
+  return -1;
+}
+
+void MappedCharStream::release(ssize_t marker) {
+}
+
+std::size_t MappedCharStream::index() {
+  return p;
+}
+
+// The position is kept inside the window: seek(0), as the parser does
+// to parse the source again, goes to the first character after the BOM
+void MappedCharStream::seek(std::size_t index) {
+  p = std::min(std::max(index, from), limit);
+}
+
+std::size_t MappedCharStream::size() {
+  return limit;
+}
+
+std::string MappedCharStream::getSourceName() const {
+  if (name.empty())
+    return IntStream::UNKNOWN_SOURCE_NAME;
+  return name;
+}
+
+// The interval is inclusive; its end is extended to the last byte of
+// the UTF-8 sequence it points to
+std::string MappedCharStream::getText(const antlr4::misc::Interval & interval) {
+  if (interval.a < 0 or interval.b < interval.a)
+    return "";
+  std::size_t start = interval.a;
+  if (start >= length)
+    return "";
+  std::size_t stop = std::min<std::size_t>(interval.b, length - 1);
+  while (stop + 1 < length and (data[stop + 1] & 0xC0) == 0x80)
+    ++stop;
+  return std::string(reinterpret_cast<const char *>(data) + start, stop - start + 1);
+}
+
+std::string MappedCharStream::toString() const {
+  return std::string(reinterpret_cast<const char *>(data), length);
+}
@@ -0,0 +1,116 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    MappedCharStream - Character stream for the lexer that reads
+//                       the source file through mmap
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "antlr4-runtime.h"
+
+#include <string>
+#include <istream>
+
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class MappedCharStream: an antlr4::CharStream that serves the bytes
+// of the source directly to the lexer, instead of converting the whole
+// text to 32-bit code points as antlr4::ANTLRInputStream does.
+// Files are mapped in memory (mmap), so they are not even copied; the
+// text read from other streams (std::cin, pipes, ...) is kept in a
+// buffer owned by the object.
+// UTF-8 sequences are decoded on the fly: LA() returns code points,
+// but the indexes (index(), seek(), token start/stop) are byte offsets,
+// so getText() is a plain substring of the source.
+
+class MappedCharStream : public antlr4::CharStream {
+
+public:
+  MappedCharStream();
+  ~MappedCharStream();
+  MappedCharStream(const MappedCharStream &) = delete;
+  MappedCharStream & operator=(const MappedCharStream &) = delete;
+
+  // Map the contents of the file filename (if it can not be mapped, for
+  // example a pipe, it is read). Returns false if it can not be opened
+  bool open (const std::string & filename);
+  // Read all the contents of the stream
+  void load (std::istream & stream);
+  // Use the text (moved into the object)
+  void load (std::string && text);
+
+  // Restrict the stream to the bytes [begin, end) of the source: it is
+  // positioned at begin and LA() returns EOF at end. The offsets are
+  // still those of the whole source, so tokens keep their positions
+  void setWindow   (std::size_t begin, std::size_t end);
+  // Back to the whole source (positioned at its start)
+  void resetWindow ();
+  // Offset of the first character of the source (after the BOM)
+  std::size_t start () const;
+
+  // Methods of antlr4::IntStream/antlr4::CharStream
+  void        consume       () override;
+  std::size_t LA            (ssize_t i) override;
+  ssize_t     mark          () override;
+  void        release       (ssize_t marker) override;
+  std::size_t index         () override;
+  void        seek          (std::size_t index) override;
+  std::size_t size          () override;
+  std::string getSourceName () const override;
+  std::string getText       (const antlr4::misc::Interval & interval) override;
+  std::string toString      () const override;
+
+  // Name of the source (the file name)
+  std::string name;
+
+private:
+  // Attributes:
+  //   - the text of the source and its size in bytes
+  const unsigned char * data;
+  std::size_t           length;
+  //   - current position (byte offset)
+  std::size_t           p;
+  //   - first byte of the text (after the BOM), and start and end
+  //     of the window (first and length if the whole source is used)
+  std::size_t           first;
+  std::size_t           from;
+  std::size_t           limit;
+  //   - the mapped memory (if the source is a mapped file)
+  void                * mapped;
+  //   - the text (if the source has been read)
+  std::string           buffer;
+
+  // Release the current source
+  void close ();
+  // Length of the UTF-8 sequence starting at byte pos (1 if invalid)
+  std::size_t sequenceLength (std::size_t pos) const;
+  // Code point of the UTF-8 sequence starting at byte pos
+  std::size_t decode         (std::size_t pos) const;
+};
@@ -37,9 +37,9 @@
 // using namespace std;
 
 
-void SemErrors::print() {
+void SemErrors::print(std::ostream & out) {
   std::sort(ErrorList.begin(), ErrorList.end(), less);  
-  for (auto & error : ErrorList) error.print();
+  for (auto & error : ErrorList) error.print(out);
 }
 
 bool SemErrors::less(const ErrorInfo & e1, const ErrorInfo & e2) {
@@ -52,6 +52,10 @@ std::size_t SemErrors::getNumberOfSemanticErrors() const {
   return ErrorList.size();
 }
 
+void SemErrors::merge(const SemErrors & other) {
+  ErrorList.insert(ErrorList.end(), other.ErrorList.begin(), other.ErrorList.end());
+}
+
 void SemErrors::declaredIdent(antlr4::tree::TerminalNode *node) {
   ErrorInfo error(node->getSymbol()->getLine(), node->getSymbol()->getCharPositionInLine(), "Identifier '" + node->getSymbol()->getText() + "' already declared.");
   ErrorList.push_back(error);
@@ -142,7 +146,11 @@ void SemErrors::nonReferenceableExpression(antlr4::ParserRuleContext *ctx) {
 }
 
 void SemErrors::noMainProperlyDeclared(antlr4::ParserRuleContext *ctx) {
-  ErrorInfo error(ctx->getStop()->getLine(), ctx->getStop()->getCharPositionInLine(), "There is no 'main' function properly declared.");
+  noMainProperlyDeclared(ctx->getStop()->getLine(), ctx->getStop()->getCharPositionInLine());
+}
+
+void SemErrors::noMainProperlyDeclared(std::size_t line, std::size_t coln) {
+  ErrorInfo error(line, coln, "There is no 'main' function properly declared.");
   ErrorList.push_back(error);
 }
 
@@ -150,8 +158,8 @@ SemErrors::ErrorInfo::ErrorInfo(std::size_t line, std::size_t coln, std::string
   : line{line}, coln{coln}, message{message} {
 }
 
-void SemErrors::ErrorInfo::print() const {
-  std::cout << "Line " << line << ":" << coln << " error: " << message << std::endl;
+void SemErrors::ErrorInfo::print(std::ostream & out) const {
+  out << "Line " << line << ":" << coln << " error: " << message << std::endl;
 }
 
 std::size_t SemErrors::ErrorInfo::getLine() const {
@@ -32,6 +32,7 @@
 
 #include <string>
 #include <vector>
+#include <iostream>
 
 // using namespace std;
 
@@ -53,11 +54,15 @@ public:
   SemErrors() = default;
 
   // Write the semantic errors ordered by line number
-  void print ();
+  void print (std::ostream & out = std::cout);
 
   // Accessor to get the number of semantic errors
   std::size_t getNumberOfSemanticErrors () const;
 
+  // Add the errors found by another visitor (for example, one that
+  // checked some functions in parallel with its own SemErrors)
+  void merge (const SemErrors & other);
+
   // Methods that store the error messages
   //   node is the terminal node correspondig to the token IDENT in a declaration
   void declaredIdent                (antlr4::tree::TerminalNode *node);
@@ -104,6 +109,9 @@ public:
   void nonReferenceableExpression   (antlr4::ParserRuleContext *ctx);
   //   ctx is the program node (grammar start symbol) 
   void noMainProperlyDeclared       (antlr4::ParserRuleContext *ctx);
+  //   line and coln are the position of the end of the program
+  //   (used when there is no program node, in streaming mode)
+  void noMainProperlyDeclared       (std::size_t line, std::size_t coln);
 
 
 private:
@@ -115,7 +123,7 @@ private:
     std::size_t getLine() const;
     std::size_t getColumnInLine() const;
     std::string getMessage() const;
-    void print() const;
+    void print(std::ostream & out) const;
   private:
     std::size_t line, coln;
     std::string message;
@@ -31,7 +31,10 @@
 #include "SymTable.h"
 
 #include <string>
+#include <string_view>
+#include <functional> // std::hash
 #include <iostream>
+#include <algorithm>  // std::find
 
 #include <cstddef>    // std::size_t
 // uncomment to disable assert()
@@ -53,7 +56,8 @@ SymTable::SymTable(TypesMgr & Types) :
 // and returns this ScopeId.
 SymTable::ScopeId SymTable::pushNewScope(const std::string & name) {
   ScopeId currScope = ScopesVec.size();
-  ScopesVec.push_back(ScopeInfo(name));
+  ScopeId parent = ScopeIdsStack.empty() ? NoScope : ScopeIdsStack.back();
+  ScopesVec.push_back(ScopeInfo(name, parent));
   ScopeIdsStack.push_back(currScope);
   return currScope;
 }
@@ -70,6 +74,13 @@ void SymTable::pushThisScope(ScopeId scope) {
   ScopeIdsStack.push_back(scope);
 }
 
+// Remove the last created scope, once it is no longer needed
+void SymTable::dropLastScope(ScopeId scope) {
+  assert(scope + 1 == ScopesVec.size());
+  assert(std::find(ScopeIdsStack.begin(), ScopeIdsStack.end(), scope) == ScopeIdsStack.end());
+  ScopesVec.pop_back();
+}
+
 // Returns the current scope.
 SymTable::ScopeId SymTable::topScope() const {
   assert(not ScopeIdsStack.empty());
@@ -81,7 +92,8 @@ bool SymTable::findInCurrentScope(const std::string & ident) const {
   assert(not ScopeIdsStack.empty());
   ScopeId currScope = ScopeIdsStack.back();
   assert(currScope < ScopesVec.size());
-  return (ScopesVec[currScope].findSymbol(ident));
+  Atom a = Atoms.find(ident);
+  return a != NoAtom and ScopesVec[currScope].findSymbol(a);
 }
 
 // Returns an integer >= 0 if ident occurs in some of the scopes
@@ -90,11 +102,14 @@ bool SymTable::findInCurrentScope(const std::string & ident) const {
 // Returns -1 if te symbol is not found.
 int SymTable::findInStack(const std::string & ident) const {
   assert(not ScopeIdsStack.empty());
+  Atom a = Atoms.find(ident);
+  if (a == NoAtom)
+    return -1;
   int d = 0;
   for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
     ScopeId sc = ScopeIdsStack[i];
     assert(sc < ScopesVec.size());
-    if (ScopesVec[sc].findSymbol(ident))
+    if (ScopesVec[sc].findSymbol(a))
       return d;
     ++d;
   }
@@ -106,76 +121,160 @@ void SymTable::addLocalVar(const std::string & ident, TypesMgr::TypeId type) {
   assert(not ScopeIdsStack.empty());
   ScopeId currScope = ScopeIdsStack.back();
   assert(currScope < ScopesVec.size());
-  ScopesVec[currScope].addLocalVar(ident, type);
+  ScopesVec[currScope].addLocalVar(Atoms.intern(ident), type);
 }
 void SymTable::addParameter(const std::string & ident, TypesMgr::TypeId type) {
   assert(not ScopeIdsStack.empty());
   ScopeId currScope = ScopeIdsStack.back();
   assert(currScope < ScopesVec.size());
-  ScopesVec[currScope].addParameter(ident, type);
+  ScopesVec[currScope].addParameter(Atoms.intern(ident), type);
 }
 
 void SymTable::addFunction(const std::string & ident, TypesMgr::TypeId type) {
   assert(not ScopeIdsStack.empty());
   ScopeId currScope = ScopeIdsStack.back();
   assert(currScope < ScopesVec.size());
-  ScopesVec[currScope].addFunction(ident, type);
+  ScopesVec[currScope].addFunction(Atoms.intern(ident), type);
 }
 
-// Check the class of a symbol. If not found return false
-bool SymTable::isLocalVarClass(const std::string & ident) const {
+// Find the innermost scope of the stack where ident is declared
+SymTable::ScopeId SymTable::findScopeInStack(Atom ident) const {
   assert(not ScopeIdsStack.empty());
+  if (ident == NoAtom)
+    return NoScope;
   for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
     ScopeId sc = ScopeIdsStack[i];
     assert(sc < ScopesVec.size());
     if (ScopesVec[sc].findSymbol(ident))
-      return ScopesVec[sc].isLocalVarClass(ident);
+      return sc;
   }
-  return false;
+  return NoScope;
+}
+
+// Check the class of a symbol. If not found return false
+bool SymTable::isLocalVarClass(const std::string & ident) const {
+  Atom a = Atoms.find(ident);
+  ScopeId found = findScopeInStack(a);
+  return found != NoScope and ScopesVec[found].isLocalVarClass(a);
 }
 
 bool SymTable::isParameterClass(const std::string & ident) const {
-  assert(not ScopeIdsStack.empty());
-  for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
-    ScopeId sc = ScopeIdsStack[i];
-    assert(sc < ScopesVec.size());
-    if (ScopesVec[sc].findSymbol(ident))
-      return ScopesVec[sc].isParameterClass(ident);
-  }
-  return false;
+  Atom a = Atoms.find(ident);
+  ScopeId found = findScopeInStack(a);
+  return found != NoScope and ScopesVec[found].isParameterClass(a);
 }
 
 bool SymTable::isFunctionClass(const std::string & ident) const {
-  assert(not ScopeIdsStack.empty());
-  for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
-    ScopeId sc = ScopeIdsStack[i];
-    assert(sc < ScopesVec.size());
-    if (ScopesVec[sc].findSymbol(ident))
-      return ScopesVec[sc].isFunctionClass(ident);
-  }
-  return false;
+  Atom a = Atoms.find(ident);
+  ScopeId found = findScopeInStack(a);
+  return found != NoScope and ScopesVec[found].isFunctionClass(a);
 }
 
 // Get the TypeId of a symbol. If not found return type 'error'
 TypesMgr::TypeId SymTable::getType(const std::string & ident) const {
-  assert(not ScopeIdsStack.empty());
-  for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
-    ScopeId sc = ScopeIdsStack[i];
+  Atom a = Atoms.find(ident);
+  ScopeId found = findScopeInStack(a);
+  if (found == NoScope)
+    return Types.createErrorTy();
+  return ScopesVec[found].getType(a);
+}
+
+// Find the scope where ident is declared, starting at the scope sc
+// and following the chain of enclosing scopes.
+SymTable::ScopeId SymTable::findScopeOf(ScopeId sc, Atom ident) const {
+  if (ident == NoAtom)
+    return NoScope;
+  while (sc != NoScope) {
     assert(sc < ScopesVec.size());
     if (ScopesVec[sc].findSymbol(ident))
-      return ScopesVec[sc].getType(ident);
+      return sc;
+    sc = ScopesVec[sc].getParent();
   }
-  return Types.createErrorTy();
+  return NoScope;
+}
+
+// Read-only accessors starting at an explicit scope
+bool SymTable::findInScopes(ScopeId sc, const std::string & ident) const {
+  return findScopeOf(sc, Atoms.find(ident)) != NoScope;
+}
+
+bool SymTable::isLocalVarClass(ScopeId sc, const std::string & ident) const {
+  return isLocalVarClass(sc, Atoms.find(ident));
+}
+
+bool SymTable::isParameterClass(ScopeId sc, const std::string & ident) const {
+  return isParameterClass(sc, Atoms.find(ident));
+}
+
+bool SymTable::isFunctionClass(ScopeId sc, const std::string & ident) const {
+  return isFunctionClass(sc, Atoms.find(ident));
+}
+
+TypesMgr::TypeId SymTable::getType(ScopeId sc, const std::string & ident) const {
+  return getType(sc, Atoms.find(ident));
+}
+
+bool SymTable::findInScopes(ScopeId sc, Atom ident) const {
+  return findScopeOf(sc, ident) != NoScope;
+}
+
+bool SymTable::isLocalVarClass(ScopeId sc, Atom ident) const {
+  ScopeId found = findScopeOf(sc, ident);
+  return found != NoScope and ScopesVec[found].isLocalVarClass(ident);
+}
+
+bool SymTable::isParameterClass(ScopeId sc, Atom ident) const {
+  ScopeId found = findScopeOf(sc, ident);
+  return found != NoScope and ScopesVec[found].isParameterClass(ident);
+}
+
+bool SymTable::isFunctionClass(ScopeId sc, Atom ident) const {
+  ScopeId found = findScopeOf(sc, ident);
+  return found != NoScope and ScopesVec[found].isFunctionClass(ident);
+}
+
+TypesMgr::TypeId SymTable::getType(ScopeId sc, Atom ident) const {
+  ScopeId found = findScopeOf(sc, ident);
+  if (found == NoScope)
+    return Types.createErrorTy();
+  return ScopesVec[found].getType(ident);
+}
+
+SymTable::Binding SymTable::resolve(ScopeId sc, Atom ident) const {
+  Binding b;
+  ScopeId found = findScopeOf(sc, ident);
+  if (found == NoScope) {
+    b.type = Types.createErrorTy();
+    return b;
+  }
+  b.scope = found;
+  ScopesVec[found].bind(ident, b);
+  return b;
+}
+
+// Interned identifiers
+SymTable::Atom SymTable::getAtom(std::string_view ident) const {
+  return Atoms.find(ident);
+}
+
+SymTable::Atom SymTable::intern(std::string_view ident) {
+  return Atoms.intern(ident);
+}
+
+const std::string & SymTable::getName(Atom ident) const {
+  return Atoms.getName(ident);
 }
 
 bool SymTable::noMainProperlyDeclared() const {
   assert(not ScopeIdsStack.empty());
   ScopeId currScope = ScopeIdsStack.back();
   assert(currScope < ScopesVec.size());
-  if ((not ScopesVec[currScope].findSymbol("main")) or
-      (not ScopesVec[currScope].isFunctionClass("main")))
+  Atom main = Atoms.find("main");
+  if ((main == NoAtom) or
+      (not ScopesVec[currScope].findSymbol(main)) or
+      (not ScopesVec[currScope].isFunctionClass(main)))
     return true;
-  TypesMgr::TypeId tid = ScopesVec[currScope].getType("main");
+  TypesMgr::TypeId tid = ScopesVec[currScope].getType(main);
   if (Types.isFunctionTy(tid) and
       (Types.getNumOfParameters(tid) == 0) and
       Types.isVoidFunction(tid))
@@ -186,7 +285,7 @@ bool SymTable::noMainProperlyDeclared() const {
 // Given the name of a function, returns its TypeId
 TypesMgr::TypeId SymTable::getGlobalFunctionType(const std::string & ident) const {
   assert(not ScopesVec.empty());
-  TypesMgr::TypeId tid = ScopesVec[0].getType(ident);
+  TypesMgr::TypeId tid = ScopesVec[0].getType(Atoms.find(ident));
   return tid;
 }
 
@@ -195,7 +294,7 @@ TypesMgr::TypeId SymTable::getLocalSymbolType(const std::string & funcName,
                                               const std::string & ident) const {
   for (std::size_t i = 1; i < ScopesVec.size(); ++i) {
     if (ScopesVec[i].getName() == funcName) {
-      TypesMgr::TypeId tid = ScopesVec[i].getType(ident);
+      TypesMgr::TypeId tid = ScopesVec[i].getType(Atoms.find(ident));
       return tid;
     }
   }
@@ -208,7 +307,7 @@ void SymTable::printCurrentScope() const {
   assert(not ScopeIdsStack.empty());
   ScopeId currScope = ScopeIdsStack.back();
   assert(currScope < ScopesVec.size());
-  ScopesVec[currScope].print(Types);
+  ScopesVec[currScope].print(Types, Atoms);
 }
 
 // Write the contents of the symbol table on the standard output
@@ -217,7 +316,7 @@ void SymTable::print() const {
   for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
     ScopeId sc = ScopeIdsStack[i];
     assert(sc < ScopesVec.size());
-    ScopesVec[sc].print(Types);
+    ScopesVec[sc].print(Types, Atoms);
   }
   std::cout << "----------------" << std::endl;
 }
@@ -226,77 +325,160 @@ void SymTable::print() const {
 // class SymTable::ScopeInfo ==============================================================
 
 // Constructor
-SymTable::ScopeInfo::ScopeInfo(const std::string & name)
-  : name{name} { }
+SymTable::ScopeInfo::ScopeInfo(const std::string & name, ScopeId parent)
+  : name{name}, parent{parent} { }
 
-// Accessors to work with the attributes: name, SymbolsMap, IdentsList
+// Accessors to work with the attributes: name, parent, Symbols
 std::string SymTable::ScopeInfo::getName() const {
   return name;
 }
 
+SymTable::ScopeId SymTable::ScopeInfo::getParent() const {
+  return parent;
+}
+
+// Position of the slot where ident is, or the free slot where it
+// should be inserted. The slots are probed linearly starting at a
+// position given by the Atom
+std::size_t SymTable::ScopeInfo::probe(Atom ident) const {
+  std::size_t mask = Slots.size() - 1;
+  std::size_t i = (ident * 2654435761u) & mask;
+  while (Slots[i] != 0 and Symbols[Slots[i] - 1].first != ident)
+    i = (i + 1) & mask;
+  return i;
+}
+
+// Position in Symbols of ident, or -1 if it is not found
+int SymTable::ScopeInfo::findIndex(Atom ident) const {
+  if (Slots.empty())
+    return -1;
+  return int(Slots[probe(ident)]) - 1;
+}
+
+// Adds a symbol. The table of slots is kept at most half full
+void SymTable::ScopeInfo::addSymbol(Atom ident, const SymbolInfo & info) {
+  assert(findIndex(ident) == -1);
+  Symbols.emplace_back(ident, info);
+  if (2 * Symbols.size() > Slots.size()) {
+    Slots.assign(Slots.empty() ? 8 : 2 * Slots.size(), 0);
+    for (std::size_t k = 0; k < Symbols.size(); ++k)
+      Slots[probe(Symbols[k].first)] = k + 1;
+  }
+  else
+    Slots[probe(ident)] = Symbols.size();
+}
+
 // Mutators to add symbols to the scope
-void SymTable::ScopeInfo::addLocalVar(const std::string & ident, TypesMgr::TypeId type) {
-  assert(SymbolsMap.find(ident) == SymbolsMap.end());
-  SymbolsMap[ident] = SymbolInfo::createLocalVar(type);
-  IdentsList.push_back(ident);
+void SymTable::ScopeInfo::addLocalVar(Atom ident, TypesMgr::TypeId type) {
+  addSymbol(ident, SymbolInfo::createLocalVar(type));
 }
-void SymTable::ScopeInfo::addParameter(const std::string & ident, TypesMgr::TypeId type) {
-  assert(SymbolsMap.find(ident) == SymbolsMap.end());
-  SymbolsMap[ident] = SymbolInfo::createParameter(type);
-  IdentsList.push_back(ident);
+void SymTable::ScopeInfo::addParameter(Atom ident, TypesMgr::TypeId type) {
+  addSymbol(ident, SymbolInfo::createParameter(type));
 }
-void SymTable::ScopeInfo::addFunction(const std::string & ident, TypesMgr::TypeId type) {
-  assert(SymbolsMap.find(ident) == SymbolsMap.end());
-  SymbolsMap[ident] = SymbolInfo::createFunction(type);
-  IdentsList.push_back(ident);
+void SymTable::ScopeInfo::addFunction(Atom ident, TypesMgr::TypeId type) {
+  addSymbol(ident, SymbolInfo::createFunction(type));
 }
 
 // Accessor to check the existence of a symbol
-bool SymTable::ScopeInfo::findSymbol(const std::string & ident) const {
-  return (SymbolsMap.find(ident) != SymbolsMap.end());
+bool SymTable::ScopeInfo::findSymbol(Atom ident) const {
+  return findIndex(ident) != -1;
 }
 
 // Accessors to check the class of the symbol. If not found return false
-bool SymTable::ScopeInfo::isLocalVarClass(const std::string & ident) const {
-  auto const & it = SymbolsMap.find(ident);
-  if (it == SymbolsMap.end())
-    return false;
-  return it->second.isLocalVarClass();
+bool SymTable::ScopeInfo::isLocalVarClass(Atom ident) const {
+  int i = findIndex(ident);
+  return i != -1 and Symbols[i].second.isLocalVarClass();
 }
-bool SymTable::ScopeInfo::isParameterClass(const std::string & ident) const {
-  auto const & it = SymbolsMap.find(ident);
-  if (it == SymbolsMap.end())
-    return false;
-  return it->second.isParameterClass();
+bool SymTable::ScopeInfo::isParameterClass(Atom ident) const {
+  int i = findIndex(ident);
+  return i != -1 and Symbols[i].second.isParameterClass();
 }
-bool SymTable::ScopeInfo::isFunctionClass(const std::string & ident) const {
-  auto const & it = SymbolsMap.find(ident);
-  if (it == SymbolsMap.end())
-    return false;
-  return it->second.isFunctionClass();
+bool SymTable::ScopeInfo::isFunctionClass(Atom ident) const {
+  int i = findIndex(ident);
+  return i != -1 and Symbols[i].second.isFunctionClass();
 }
 
 // Accessor to get the TypeId of a symbol. The symbol MUST exist.
-TypesMgr::TypeId SymTable::ScopeInfo::getType(const std::string & ident) const {
-  assert(SymbolsMap.find(ident) != SymbolsMap.end());
-  auto const & it = SymbolsMap.find(ident);
-  return it->second.getType();
+TypesMgr::TypeId SymTable::ScopeInfo::getType(Atom ident) const {
+  int i = findIndex(ident);
+  assert(i != -1);
+  return Symbols[i].second.getType();
+}
+
+// Fills the binding of a symbol. The symbol MUST exist.
+void SymTable::ScopeInfo::bind(Atom ident, Binding & b) const {
+  int i = findIndex(ident);
+  assert(i != -1);
+  const SymbolInfo & info = Symbols[i].second;
+  if (info.isLocalVarClass())
+    b.cls = Binding::LocalVar;
+  else if (info.isParameterClass())
+    b.cls = Binding::Parameter;
+  else if (info.isFunctionClass())
+    b.cls = Binding::Function;
+  b.type  = info.getType();
+  b.index = i;
 }
 
 // Writes the contents of the scope to the standard output.
-void SymTable::ScopeInfo::print(TypesMgr & Types) const {
+void SymTable::ScopeInfo::print(TypesMgr & Types, const AtomTable & Atoms) const {
   std::cout << "---------------- scope name: " << name << std::endl;
-  for (auto & id : IdentsList) {
-    auto const & it = SymbolsMap.find(id);
-    std::cout << id << ":" << it->second.class2string();
-    if (not it->second.isErrorClass()) {
-      std::cout << "," << Types.to_string(it->second.getType());
+  for (auto & sym : Symbols) {
+    std::cout << Atoms.getName(sym.first) << ":" << sym.second.class2string();
+    if (not sym.second.isErrorClass()) {
+      std::cout << "," << Types.to_string(sym.second.getType());
     }
     std::cout << std::endl;
   }
 }
 
 
+// class SymTable::AtomTable ==============================================================
+
+// Position of the slot where name is, or the free slot where it
+// should be inserted (linear probing)
+std::size_t SymTable::AtomTable::probe(std::string_view name) const {
+  std::size_t mask = Slots.size() - 1;
+  std::size_t i = std::hash<std::string_view>()(name) & mask;
+  while (Slots[i] != 0 and Names[Slots[i] - 1] != name)
+    i = (i + 1) & mask;
+  return i;
+}
+
+// Doubles the number of slots and reinserts all the names
+void SymTable::AtomTable::grow() {
+  Slots.assign(Slots.empty() ? 64 : 2 * Slots.size(), 0);
+  for (std::size_t a = 0; a < Names.size(); ++a)
+    Slots[probe(Names[a])] = a + 1;
+}
+
+// Returns the Atom of name, adding it if it is new
+SymTable::Atom SymTable::AtomTable::intern(std::string_view name) {
+  if (2 * (Names.size() + 1) > Slots.size())
+    grow();
+  std::size_t i = probe(name);
+  if (Slots[i] == 0) {
+    Names.emplace_back(name);
+    Slots[i] = Names.size();
+  }
+  return Slots[i] - 1;
+}
+
+// Returns the Atom of name, or NoAtom if it is not in the table
+SymTable::Atom SymTable::AtomTable::find(std::string_view name) const {
+  if (Slots.empty())
+    return NoAtom;
+  std::size_t i = probe(name);
+  return Slots[i] == 0 ? NoAtom : Slots[i] - 1;
+}
+
+// Returns the name of an Atom
+const std::string & SymTable::AtomTable::getName(Atom a) const {
+  assert(a < Names.size());
+  return Names[a];
+}
+
+
 // class SymTable::ScopeInfo::SymbolInfo ==========================================================
 
 // Constructors
@@ -31,10 +31,13 @@
 #include "TypesMgr.h"
 
 #include <string>
-#include <map>
+#include <string_view>
+#include <deque>
 #include <vector>
+#include <utility>
 
 #include <cstddef>    // std::size_t
+#include <cstdint>    // std::uint32_t
 // uncomment to disable assert()
 // #define NDEBUG
 #include <cassert>
@@ -57,6 +60,11 @@
 // scopes that determines which symbols are visible and
 // which are not. Entering in a function will push a new
 // scope to the stack and exiting will pop the stack.
+// The identifiers are interned: each different name gets a
+// small integer (Atom) the first time a symbol with that name
+// is added (or the tree is lowered, see intern), and the scopes
+// are hash tables keyed by Atom. The lookups by name only probe
+// the table of atoms, so they allocate no memory.
 
 class SymTable {
 
@@ -65,6 +73,10 @@ public:
   // The ScopeId is an index in a vector
   typedef std::size_t ScopeId;
 
+  // The Atom of an identifier is an index in the table of names
+  typedef std::uint32_t Atom;
+  static const Atom NoAtom = Atom(-1);
+
   // Name of the Global Scope
   static const std::string GLOBAL_SCOPE_NAME;
 
@@ -80,6 +92,9 @@ public:
   void    popScope      ();
   //   - push a previously created scope sc and set it as current scope
   void    pushThisScope (ScopeId sc);
+  //   - remove the scope sc, that must be the last one created and not
+  //     be in the stack. Its ScopeId is given to the next new scope
+  void    dropLastScope (ScopeId sc);
   //   - returns the current scope
   ScopeId topScope      ()                          const;
 
@@ -103,6 +118,46 @@ public:
   // Accessor to get the TypeId of a symbol. If not found return type 'error'
   TypesMgr::TypeId getType (const std::string & ident) const;
 
+  // Read-only versions of the accessors above that look for the symbol
+  // starting at the scope sc (and following its enclosing scopes)
+  // instead of using the stack of scopes. Once all the symbols have
+  // been added they can be called concurrently from several threads.
+  bool             findInScopes     (ScopeId sc, const std::string & ident) const;
+  bool             isLocalVarClass  (ScopeId sc, const std::string & ident) const;
+  bool             isParameterClass (ScopeId sc, const std::string & ident) const;
+  bool             isFunctionClass  (ScopeId sc, const std::string & ident) const;
+  TypesMgr::TypeId getType          (ScopeId sc, const std::string & ident) const;
+
+  // Versions of the read-only accessors for an already interned
+  // identifier (see getAtom)
+  bool             findInScopes     (ScopeId sc, Atom ident) const;
+  bool             isLocalVarClass  (ScopeId sc, Atom ident) const;
+  bool             isParameterClass (ScopeId sc, Atom ident) const;
+  bool             isFunctionClass  (ScopeId sc, Atom ident) const;
+  TypesMgr::TypeId getType          (ScopeId sc, Atom ident) const;
+
+  // Binding of an identifier: the class and the type of the symbol
+  // it refers to, and its slot (the scope where it is declared and
+  // its position among the symbols of that scope)
+  struct Binding {
+    enum Class : std::uint8_t { Undeclared, LocalVar, Parameter, Function };
+    Class            cls   = Undeclared;
+    TypesMgr::TypeId type  = 0;
+    ScopeId          scope = 0;
+    std::uint32_t    index = 0;
+  };
+  // Resolves an interned identifier looking for it from the scope sc
+  // (as the read-only accessors above), with a single walk of the scopes
+  Binding          resolve          (ScopeId sc, Atom ident) const;
+
+  // Returns the Atom of an identifier, or NoAtom if it has not
+  // been interned
+  Atom                getAtom (std::string_view ident) const;
+  // Returns the Atom of an identifier, interning it if it is new
+  Atom                intern  (std::string_view ident);
+  // Returns the name of an Atom
+  const std::string & getName (Atom ident)             const;
+
   // Check the existence of the "main" function
   bool noMainProperlyDeclared() const;
 
@@ -120,14 +175,54 @@ public:
 
 
 private:
-  // Forward declaration of class ScopeInfo
+  // Forward declaration of classes AtomTable and ScopeInfo
+  class AtomTable;
   class ScopeInfo;
 
+  //////////////////////////////////////////////////////////////////
+  // Class AtomTable: is declared inside SymTable and is private.
+  // It interns the names of the symbols: an open addressing hash
+  // table maps each name to its Atom, that is its position in
+  // the list of names.
+
+  class AtomTable {
+  public:
+    // Returns the Atom of name, adding it if it is new
+    Atom                intern (std::string_view name);
+    // Returns the Atom of name, or NoAtom if it is not in the table
+    Atom                find   (std::string_view name) const;
+    // Returns the name of an Atom
+    const std::string & getName (Atom a)                const;
+
+  private:
+    // The names, indexed by Atom (a deque does not move them)
+    std::deque<std::string> Names;
+    // Slots of the hash table: Atom + 1, or 0 if the slot is free
+    std::vector<Atom>       Slots;
+
+    // Position of the slot where name is (or should be inserted)
+    std::size_t probe (std::string_view name) const;
+    // Doubles the number of slots and reinserts all the names
+    void        grow  ();
+
+  };  // class AtomTable
+
   // Attributes:
   TypesMgr               & Types;
+  AtomTable                Atoms;
   std::vector<ScopeInfo>   ScopesVec;
   std::vector<ScopeId>     ScopeIdsStack;
 
+  // ScopeId of the enclosing scope of the global scope
+  static const ScopeId NoScope = ScopeId(-1);
+
+  // Returns the scope (sc or one of its enclosing scopes) where
+  // ident is declared, or NoScope if it is not found
+  ScopeId findScopeOf      (ScopeId sc, Atom ident) const;
+  // Returns the innermost scope of the stack where ident is
+  // declared, or NoScope if it is not found
+  ScopeId findScopeInStack (Atom ident)             const;
+
   //////////////////////////////////////////////////////////////////
   // Class ScopeInfo: is declared inside SymTable and is private,
   // so only the SymTable can operate with Scope objects.
@@ -137,41 +232,58 @@ private:
   public:
     // Constructor
     ScopeInfo () = delete;
-    ScopeInfo (const std::string & name);
+    ScopeInfo (const std::string & name, ScopeId parent);
 
     // Accessor to get the name of the scope
     std::string getName () const;
+    // Accessor to get the enclosing scope (NoScope for the global one)
+    ScopeId     getParent () const;
 
     // Mutators to add symbols to the scope
-    void addLocalVar  (const std::string & ident, TypesMgr::TypeId type);
-    void addParameter (const std::string & ident, TypesMgr::TypeId type);
-    void addFunction  (const std::string & ident, TypesMgr::TypeId type);
+    void addLocalVar  (Atom ident, TypesMgr::TypeId type);
+    void addParameter (Atom ident, TypesMgr::TypeId type);
+    void addFunction  (Atom ident, TypesMgr::TypeId type);
 
     // Accessor to check the existence of a symbol
-    bool findSymbol (const std::string & ident) const;
+    bool findSymbol (Atom ident) const;
 
     // Accessors to check the class of the symbol. If not found return false
-    bool isLocalVarClass  (const std::string & ident) const;
-    bool isParameterClass (const std::string & ident) const;
-    bool isFunctionClass  (const std::string & ident) const;
+    bool isLocalVarClass  (Atom ident) const;
+    bool isParameterClass (Atom ident) const;
+    bool isFunctionClass  (Atom ident) const;
 
     // Accessor to get the TypeId of a symbol. The symbol MUST exist
-    TypesMgr::TypeId getType (const std::string & ident) const;
+    TypesMgr::TypeId getType (Atom ident) const;
+
+    // Fills the class, type and index of the binding of a symbol.
+    // The symbol MUST exist
+    void bind (Atom ident, Binding & b) const;
 
     // Writes the contents of the scope to the standard output
-    void print (TypesMgr & Types) const;
+    void print (TypesMgr & Types, const AtomTable & Atoms) const;
 
   private:
 
     // Formard decration of class SymbolInfo
     class SymbolInfo;
 
+    // Adds the symbol ident with its information
+    void        addSymbol (Atom ident, const SymbolInfo & info);
+    // Position in Symbols of ident, or -1 if it is not found
+    int         findIndex (Atom ident) const;
+    // Position of the slot where ident is (or should be inserted)
+    std::size_t probe     (Atom ident) const;
+
     // For the name of the scope
     std::string name;
-    // The information associated to each identifier declared in this scope.
-    std::map<std::string, SymbolInfo> SymbolsMap;
-    // For remember the order in which the Ids where introduced.
-    std::vector<std::string> IdentsList;
+    // The scope that was on top of the stack when this one was created
+    ScopeId parent;
+    // The identifiers declared in this scope, in the order in which
+    // they where introduced, and the information associated to each one.
+    std::vector<std::pair<Atom, SymbolInfo>> Symbols;
+    // Open addressing hash table (keyed by Atom) of positions in
+    // Symbols: position + 1, or 0 if the slot is free
+    std::vector<std::uint32_t> Slots;
 
 
     //////////////////////////////////////////////////////////////////
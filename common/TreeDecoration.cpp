@@ -31,34 +31,78 @@
 
 #include "TypesMgr.h"
 #include "SymTable.h"
+#include "AslRuleContext.h"
 
 #include "antlr4-runtime.h"
 
+#include <cassert>
 #include <string>
 
 
+// Constructor: the tree is traversed with an explicit stack (it can
+// be very deep) and the nodes are numbered in preorder
+TreeDecoration::TreeDecoration(antlr4::tree::ParseTree *tree) {
+  std::size_t numNodes = 0;
+  std::vector<antlr4::tree::ParseTree *> pending;
+  if (tree != nullptr)
+    pending.push_back(tree);
+  while (not pending.empty()) {
+    antlr4::tree::ParseTree *node = pending.back();
+    pending.pop_back();
+    if (node->getTreeType() != antlr4::tree::ParseTreeType::RULE)
+      continue;
+    static_cast<AslRuleContext *>(node)->decorIndex = numNodes++;
+    for (auto it = node->children.rbegin(); it != node->children.rend(); ++it)
+      pending.push_back(*it);
+  }
+  ScopeDecor.resize(numNodes);
+  TypeDecor.resize(numNodes);
+  BindingDecor.resize(numNodes);
+  IsLValueDecor = std::vector<std::atomic<std::uint64_t>>((numNodes + 63) / 64);
+}
+
+std::size_t TreeDecoration::indexOf(AslRuleContext *ctx) const {
+  assert(ctx->decorIndex < ScopeDecor.size());
+  return ctx->decorIndex;
+}
+
 // Getters:
-SymTable::ScopeId TreeDecoration::getScope(antlr4::ParserRuleContext *ctx) {
-  return ScopeDecor.get(ctx);
+SymTable::ScopeId TreeDecoration::getScope(AslRuleContext *ctx) const {
+  return ScopeDecor[indexOf(ctx)];
 }
 
-TypesMgr::TypeId TreeDecoration::getType(antlr4::ParserRuleContext *ctx) {
-  return TypeDecor.get(ctx);
+TypesMgr::TypeId TreeDecoration::getType(AslRuleContext *ctx) const {
+  return TypeDecor[indexOf(ctx)];
 }
 
-bool TreeDecoration::getIsLValue(antlr4::ParserRuleContext *ctx) {
-  return IsLValueDecor.get(ctx);
+bool TreeDecoration::getIsLValue(AslRuleContext *ctx) const {
+  std::size_t i = indexOf(ctx);
+  std::uint64_t word = IsLValueDecor[i / 64].load(std::memory_order_relaxed);
+  return (word >> (i % 64)) & 1;
+}
+
+SymTable::Binding TreeDecoration::getBinding(AslRuleContext *ctx) const {
+  return BindingDecor[indexOf(ctx)];
 }
 
 // Setters:
-void TreeDecoration::putScope(antlr4::ParserRuleContext *ctx, SymTable::ScopeId s) {
-  ScopeDecor.put(ctx, s);
+void TreeDecoration::putScope(AslRuleContext *ctx, SymTable::ScopeId s) {
+  ScopeDecor[indexOf(ctx)] = s;
+}
+
+void TreeDecoration::putType(AslRuleContext *ctx, TypesMgr::TypeId t) {
+  TypeDecor[indexOf(ctx)] = t;
 }
 
-void TreeDecoration::putType(antlr4::ParserRuleContext *ctx, TypesMgr::TypeId t) {
-  TypeDecor.put(ctx, t);
+void TreeDecoration::putIsLValue(AslRuleContext *ctx, bool b) {
+  std::size_t i = indexOf(ctx);
+  std::uint64_t mask = std::uint64_t(1) << (i % 64);
+  if (b)
+    IsLValueDecor[i / 64].fetch_or(mask, std::memory_order_relaxed);
+  else
+    IsLValueDecor[i / 64].fetch_and(~mask, std::memory_order_relaxed);
 }
 
-void TreeDecoration::putIsLValue(antlr4::ParserRuleContext *ctx, bool b) {
-  IsLValueDecor.put(ctx, b);
+void TreeDecoration::putBinding(AslRuleContext *ctx, const SymTable::Binding & b) {
+  BindingDecor[indexOf(ctx)] = b;
 }
@@ -31,23 +31,28 @@
 
 #include "TypesMgr.h"
 #include "SymTable.h"
+#include "AslRuleContext.h"
 
 #include "antlr4-runtime.h"
-#include "tree/ParseTreeProperty.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
 
 // using namespace std;
 
 
 //////////////////////////////////////////////////////////////////////
 // Class TreeDecoration: the nodes of the parser tree generated
-// by the antlr4 parser, whose base type is
-// antlr4::ParserRuleContext *, can have different attributes.
-// TreeDecoration groups all of them, and uses different
-// ParseTreeProperty to save this information.
-// Currently three kinds of attributes may be present:
+// by the antlr4 parser, whose base type is AslRuleContext *,
+// can have different attributes. TreeDecoration groups all of them.
+// When it is created, every node of the tree gets a number, and
+// each attribute is kept in a vector indexed by that number.
+// Currently four kinds of attributes may be present:
 //   - scope, for nodes like the program, or functions
 //   - type, for expressions or type especification
-//   - isLValue, for expressions
+//   - isLValue, for expressions (kept in a bitset)
+//   - binding, for identifiers: the symbol they refer to
 // Different visitors set and access these attributes:
 //   - SymbolsVisitor     [TypeCheck phase 1]
 //       * set and access the scope attribute
@@ -56,28 +61,43 @@
 //       * access the scope attribute
 //       * set and access the type attribute (in expressions)
 //       * set and access the isLValue attribute (in expressions)
+//       * set the binding attribute (in identifiers)
 //   - CodeGenVisitor     [Code Generation]
 //       * access the scope attribute
 //       * access the type attribute
+//       * access the binding attribute
+// A node with no value gives the default one (0 or false). The
+// slots of all the nodes are allocated beforehand, so visitors
+// that run in parallel over different subtrees can put their
+// attributes directly in the same TreeDecoration.
 
 class TreeDecoration {
 
 public:
-  TreeDecoration() = default;
+  // Constructor: number all the nodes of the tree
+  explicit TreeDecoration(antlr4::tree::ParseTree *tree);
 
   // Getters:
-  SymTable::ScopeId getScope    (antlr4::ParserRuleContext *ctx);
-  TypesMgr::TypeId  getType     (antlr4::ParserRuleContext *ctx);
-  bool              getIsLValue (antlr4::ParserRuleContext *ctx);
+  SymTable::ScopeId getScope    (AslRuleContext *ctx) const;
+  TypesMgr::TypeId  getType     (AslRuleContext *ctx) const;
+  bool              getIsLValue (AslRuleContext *ctx) const;
+  SymTable::Binding getBinding  (AslRuleContext *ctx) const;
 
   // Setters:
-  void putScope    (antlr4::ParserRuleContext *ctx, SymTable::ScopeId s);
-  void putType     (antlr4::ParserRuleContext *ctx, TypesMgr::TypeId t);
-  void putIsLValue (antlr4::ParserRuleContext *ctx, bool b);
+  void putScope    (AslRuleContext *ctx, SymTable::ScopeId s);
+  void putType     (AslRuleContext *ctx, TypesMgr::TypeId t);
+  void putIsLValue (AslRuleContext *ctx, bool b);
+  void putBinding  (AslRuleContext *ctx, const SymTable::Binding & b);
 
 private:
-  antlr4::tree::ParseTreeProperty<SymTable::ScopeId> ScopeDecor;
-  antlr4::tree::ParseTreeProperty<TypesMgr::TypeId>  TypeDecor;
-  antlr4::tree::ParseTreeProperty<bool>              IsLValueDecor;
+  std::vector<SymTable::ScopeId>           ScopeDecor;
+  std::vector<TypesMgr::TypeId>            TypeDecor;
+  // One bit per node; the words are atomic so that two threads can
+  // set the bits of different nodes that share a word
+  std::vector<std::atomic<std::uint64_t>>  IsLValueDecor;
+  std::vector<SymTable::Binding>           BindingDecor;
+
+  // Number of the node ctx (checking it belongs to the tree)
+  std::size_t indexOf (AslRuleContext *ctx) const;
 
 };  // class TreeDecoration
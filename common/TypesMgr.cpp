@@ -85,16 +85,80 @@ TypesMgr::TypeId TypesMgr::createVoidTy() {
   return VoidTyId;
 }
 
+// The parameters are appended to the ParamsPool, and removed
+// from it if the function type already existed
 TypesMgr::TypeId TypesMgr::createFunctionTy(const std::vector<TypeId> & paramsTypes,
 					    TypeId returnType) {
-  TypesVec.push_back(Type(paramsTypes, returnType));
-  return TypesVec.size()-1;
+  std::size_t pos = ParamsPool.size();
+  ParamsPool.insert(ParamsPool.end(), paramsTypes.begin(), paramsTypes.end());
+  TypeId tid = internCompoundTy(Type(pos, paramsTypes.size(), returnType));
+  if (TypesVec[tid].getFuncParamsPos() != pos)
+    ParamsPool.resize(pos);
+  return tid;
 }
 
 TypesMgr::TypeId TypesMgr::createArrayTy(unsigned int size,
 					 TypeId elemType) {
-  TypesVec.push_back(Type{size, elemType});
-  return TypesVec.size()-1;
+  return internCompoundTy(Type(size, elemType));
+}
+
+// ----------------------------------------------------------------------
+// hash-consing of the compound types
+
+std::size_t TypesMgr::hashType(const Type & t) const {
+  std::size_t h = t.getTypeKind();
+  auto combine = [&h](std::size_t v) {
+    h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+  };
+  if (t.isArrayTy()) {
+    combine(t.getArraySize());
+    combine(t.getArrayElemType());
+  }
+  else {
+    combine(t.getNumOfParameters());
+    combine(t.getFuncReturnType());
+    for (std::size_t i = 0; i < t.getNumOfParameters(); ++i)
+      combine(ParamsPool[t.getFuncParamsPos() + i]);
+  }
+  return h;
+}
+
+bool TypesMgr::sameType(const Type & t1, const Type & t2) const {
+  if (t1.getTypeKind() != t2.getTypeKind())
+    return false;
+  if (t1.isArrayTy())
+    return (t1.getArraySize() == t2.getArraySize() and
+	    t1.getArrayElemType() == t2.getArrayElemType());
+  if (t1.getNumOfParameters() != t2.getNumOfParameters() or
+      t1.getFuncReturnType() != t2.getFuncReturnType())
+    return false;
+  for (std::size_t i = 0; i < t1.getNumOfParameters(); ++i)
+    if (ParamsPool[t1.getFuncParamsPos() + i] != ParamsPool[t2.getFuncParamsPos() + i])
+      return false;
+  return true;
+}
+
+// Linear probing in CompoundSlots, that is kept at most half full
+TypesMgr::TypeId TypesMgr::internCompoundTy(const Type & t) {
+  if (2 * (NumCompoundTypes + 1) > CompoundSlots.size()) {
+    CompoundSlots.assign(CompoundSlots.empty() ? 64 : 2 * CompoundSlots.size(), 0);
+    std::size_t mask = CompoundSlots.size() - 1;
+    for (TypeId tid = NumPrimitiveAndErrorTypes; tid < TypesVec.size(); ++tid) {
+      std::size_t i = hashType(TypesVec[tid]) & mask;
+      while (CompoundSlots[i] != 0)
+	i = (i + 1) & mask;
+      CompoundSlots[i] = tid;
+    }
+  }
+  std::size_t mask = CompoundSlots.size() - 1;
+  std::size_t i = hashType(t) & mask;
+  for (; CompoundSlots[i] != 0; i = (i + 1) & mask)
+    if (sameType(TypesVec[CompoundSlots[i]], t))
+      return CompoundSlots[i];
+  TypesVec.push_back(t);
+  ++NumCompoundTypes;
+  CompoundSlots[i] = TypesVec.size() - 1;
+  return CompoundSlots[i];
 }
 
 // ----------------------------------------------------------------------
@@ -151,10 +215,10 @@ bool TypesMgr::isFunctionTy(TypeId tid) const {
   return t.isFunctionTy();
 }
 
-const std::vector<TypesMgr::TypeId> & TypesMgr::getFuncParamsTypes(TypeId tid) const {
+TypesMgr::ParamsView TypesMgr::getFuncParamsTypes(TypeId tid) const {
   const Type & t = TypesVec.at(tid);
   assert(t.isFunctionTy());
-  return t.getFuncParamsTypes();
+  return ParamsView(ParamsPool.data() + t.getFuncParamsPos(), t.getNumOfParameters());
 }
 
 TypesMgr::TypeId TypesMgr::getFuncReturnType(TypeId tid) const {
@@ -172,7 +236,7 @@ std::size_t TypesMgr::getNumOfParameters(TypeId tid) const {
 TypesMgr::TypeId TypesMgr::getParameterType(TypeId tid, unsigned int i) const {
   const Type & t = TypesVec.at(tid);
   assert(t.isFunctionTy() and i < t.getNumOfParameters());
-  return t.getParameterType(i);
+  return ParamsPool[t.getFuncParamsPos() + i];
 }
 
 bool TypesMgr::isVoidFunction(TypeId tid) const {
@@ -205,39 +269,10 @@ TypesMgr::TypeId TypesMgr::getArrayElemType(TypeId tid) const {
 // ----------------------------------------------------------------------
 // methods for checking different compatibilities of Types
 
+// The types are hash-consed, so structurally equal types have
+// the same TypeId
 bool TypesMgr::equalTypes(TypeId tid1, TypeId tid2) const {
-  if (tid1 == tid2)
-    return true;
-  const Type & t1 = TypesVec.at(tid1);
-  const Type & t2 = TypesVec.at(tid2);
-  if (t1.getTypeKind() != t2.getTypeKind())
-    return false;
-  if (t1.isPrimitiveTy() and t2.isPrimitiveTy())
-    return true;
-  if (t1.isFunctionTy()) {  // or: if (t2.isFunctionTy()) {
-    if (t1.getNumOfParameters() != t2.getNumOfParameters())
-      return false;
-    TypeId tid1_aux;
-    TypeId tid2_aux;
-    for (unsigned int i = 0; i < t1.getNumOfParameters(); ++i) {
-      tid1_aux = t1.getParameterType(i);
-      tid2_aux = t2.getParameterType(i);
-      if (not equalTypes(tid1_aux, tid2_aux))
-	return false;
-    }
-    tid1_aux = t1.getFuncReturnType();
-    tid2_aux = t2.getFuncReturnType();
-    return equalTypes(tid1_aux, tid2_aux);
-  }
-  if (t1.isArrayTy()) {  // or: if (t2.isArrayTy()) {
-    if (t1.getArraySize() != t2.getArraySize()) {
-      return false;
-    }
-    TypeId tid1_aux = t1.getArrayElemType();
-    TypeId tid2_aux = t2.getArrayElemType();
-    return equalTypes(tid1_aux, tid2_aux);
-  }
-  return false;
+  return tid1 == tid2;
 }
 
 bool TypesMgr::comparableTypes(TypeId tid1, TypeId tid2,
@@ -295,11 +330,11 @@ std::string TypesMgr::to_string(TypeId tid) const {
     TypeId tid1;
     std::string s = "function<";
     if (t.getNumOfParameters() > 0) {
-      tid1 = t.getParameterType(0);
+      tid1 = getParameterType(tid, 0);
       s = s + to_string(tid1);
     }
     for (unsigned int i = 1; i < t.getNumOfParameters(); ++i) {
-      tid1 = t.getParameterType(i);
+      tid1 = getParameterType(tid, i);
       s = s + "," + to_string(tid1);
     }
     tid1 = t.getFuncReturnType();
@@ -351,21 +386,24 @@ std::string TypesMgr::to_string_basic(TypeId tid) const {
 // ----------------------------------------------------------------------
 // constructors
 
-TypesMgr::Type::Type(TypeKind tid) : ID{tid} {
+TypesMgr::Type::Type(TypeKind tid) :
+  ID{tid}, count{0}, subTy{0}, paramsPos{0} {
   assert(TypeKind::FirstPrimitiveKind < ID and
 	 ID < TypeKind::LastPrimitiveKind);
 }
 
-TypesMgr::Type::Type(const std::vector<TypeId> & paramsTypes, TypeId returnType) :
+TypesMgr::Type::Type(std::size_t paramsPos, unsigned int numParams, TypeId returnType) :
   ID{TypesMgr::TypeKind::FunctionKind},
-  funcParamsTy{paramsTypes},
-  funcReturnTy{returnType} {
+  count{numParams},
+  subTy{returnType},
+  paramsPos{paramsPos} {
   }
 
 TypesMgr::Type::Type(unsigned int arraySize, TypeId arrayElemType) :
   ID{TypesMgr::TypeKind::ArrayKind},
-  arraySize{arraySize},
-  arrayElemTy{arrayElemType} {
+  count{arraySize},
+  subTy{arrayElemType},
+  paramsPos{0} {
   }
 
 // ----------------------------------------------------------------------
@@ -426,21 +464,16 @@ bool TypesMgr::Type::isFunctionTy() const {
   return ID == TypeKind::FunctionKind;
 }
 
-const std::vector<TypesMgr::TypeId> & TypesMgr::Type::getFuncParamsTypes() const {
-  return funcParamsTy;
+std::size_t TypesMgr::Type::getFuncParamsPos() const {
+  return paramsPos;
 }
 
 TypesMgr::TypeId TypesMgr::Type::getFuncReturnType() const {
-  return funcReturnTy;
+  return subTy;
 }
 
 std::size_t TypesMgr::Type::getNumOfParameters() const {
-  return getFuncParamsTypes().size();
-}
-
-TypesMgr::TypeId TypesMgr::Type::getParameterType(unsigned int i) const {
-  assert(i < getNumOfParameters());
-  return getFuncParamsTypes()[i];
+  return count;
 }
 
 bool TypesMgr::Type::isVoidFunction() const {
@@ -455,9 +488,9 @@ bool TypesMgr::Type::isArrayTy() const {
 }
 
 unsigned int TypesMgr::Type::getArraySize() const {
-  return arraySize;
+  return count;
 }
 
 TypesMgr::TypeId TypesMgr::Type::getArrayElemType() const {
-  return arrayElemTy;
+  return subTy;
 }
@@ -46,6 +46,11 @@
 // integer, float, boolean, character and void. Also it
 // recognizes two compound types: functions and fixed-size
 // arrays. Finally there exist a special type 'error'.
+// The types are hash-consed: creating a type structurally equal
+// to an existing one returns the TypeId of the existing one, so
+// two types are equal if and only if their TypeId's are equal.
+// The types can only be created by one thread at a time, but
+// once created they can be read concurrently.
 
 class TypesMgr {
 
@@ -54,6 +59,20 @@ public:
   // The TypeId is an index in a vector
   typedef std::size_t TypeId;
 
+  // Read-only view of the types of the parameters of a function.
+  // It is valid until a new function type is created.
+  class ParamsView {
+  public:
+    ParamsView (const TypeId *first, std::size_t n) : first{first}, n{n} { }
+    const TypeId * begin      ()               const { return first; }
+    const TypeId * end        ()               const { return first + n; }
+    std::size_t    size       ()               const { return n; }
+    TypeId         operator[] (std::size_t i)  const { return first[i]; }
+  private:
+    const TypeId * first;
+    std::size_t    n;
+  };
+
   // Constructor
   TypesMgr ();
 
@@ -84,13 +103,13 @@ public:
   bool isCompoundTy         (TypeId tid) const;
 
   // Accessors to work with function types
-  bool                        isFunctionTy       (TypeId tid)     const;
-  const std::vector<TypeId> & getFuncParamsTypes (TypeId tid)     const;
-  TypeId                      getFuncReturnType  (TypeId tid)     const;
-  std::size_t                 getNumOfParameters (TypeId tid)     const;
-  TypeId                      getParameterType   (TypeId tid,
-					          unsigned int i) const;
-  bool                        isVoidFunction     (TypeId tid)     const;
+  bool        isFunctionTy       (TypeId tid)     const;
+  ParamsView  getFuncParamsTypes (TypeId tid)     const;
+  TypeId      getFuncReturnType  (TypeId tid)     const;
+  std::size_t getNumOfParameters (TypeId tid)     const;
+  TypeId      getParameterType   (TypeId tid,
+				  unsigned int i) const;
+  bool        isVoidFunction     (TypeId tid)     const;
 
   // Accessors to work with array types
   bool         isArrayTy        (TypeId tid) const;
@@ -98,7 +117,7 @@ public:
   TypeId       getArrayElemType (TypeId tid) const;
 
   // Methods to check different compatibilities of types
-  //   - structurally equal?
+  //   - structurally equal? (the same TypeId)
   bool equalTypes      (TypeId tid1, TypeId tid2)     const;
   //   - comparable with the relational operator op?
   bool comparableTypes (TypeId tid1, TypeId tid2,
@@ -123,7 +142,25 @@ private:
 
   // Attributes:
   //   - vector to save the Types
-  std::vector<Type> TypesVec;
+  std::vector<Type>   TypesVec;
+  //   - the types of the parameters of all the function types, one
+  //     list after the other
+  std::vector<TypeId> ParamsPool;
+  //   - open addressing hash table of the compound types: TypeId,
+  //     or 0 if the slot is free (0 is the 'error' type)
+  std::vector<TypeId> CompoundSlots;
+  //   - number of compound types in CompoundSlots
+  std::size_t         NumCompoundTypes = 0;
+
+  // Returns the TypeId of the compound type t (whose parameters, if
+  // it is a function, are the last ones of ParamsPool), adding it to
+  // TypesVec if it is new
+  TypeId      internCompoundTy (const Type & t);
+  // Hash of a compound type
+  std::size_t hashType         (const Type & t) const;
+  // Structural comparison of two compound types (whose subtypes are
+  // already interned)
+  bool        sameType         (const Type & t1, const Type & t2) const;
 
   // There are eight kinds of types:
   //   - an especial kind error,
@@ -165,19 +202,19 @@ private:
   // It keeps the information of any type. When a type is
   // compound, the subtypes (for example the types of the parameters
   // of a function, or the type of the elements of an array) are
-  // referenced by their respective TypeId's.
+  // referenced by their respective TypeId's. The TypeId's of the
+  // parameters of a function are kept in the ParamsPool of the
+  // TypesMgr, so a Type is a small trivially copyable object.
   class Type {
 
   public:
     // Constructors for primitive, function and array Types
-    Type (TypeKind                    tid = TypeKind::VoidKind);
-    Type (const std::vector<TypeId> & paramsTypes,
-	  TypeId                      returnType);
-    Type (unsigned int                arraySize,
-	  TypeId                      arrayElemType);
-
-    // Destructor
-    ~Type () = default;
+    Type (TypeKind     tid = TypeKind::VoidKind);
+    Type (std::size_t  paramsPos,
+	  unsigned int numParams,
+	  TypeId       returnType);
+    Type (unsigned int arraySize,
+	  TypeId       arrayElemType);
 
     // Accesor to get the kind
     TypeKind getTypeKind () const;
@@ -194,12 +231,11 @@ private:
     bool isPrimitiveNonVoidTy () const;
 
     // Accessors to work with function types
-    bool                        isFunctionTy       ()               const;
-    const std::vector<TypeId> & getFuncParamsTypes ()               const;
-    TypeId                      getFuncReturnType  ()               const;
-    std::size_t                 getNumOfParameters ()               const;
-    TypeId                      getParameterType   (unsigned int i) const;
-    bool                        isVoidFunction     ()               const;
+    bool        isFunctionTy       () const;
+    std::size_t getFuncParamsPos   () const;
+    TypeId      getFuncReturnType  () const;
+    std::size_t getNumOfParameters () const;
+    bool        isVoidFunction     () const;
 
     // Accessors to work with array types
     bool         isArrayTy        () const;
@@ -211,12 +247,13 @@ private:
     // Atributes:
     //   - the kind of type
     TypeKind ID;
-    //   - to represent the type of a function:
-    std::vector<TypeId> funcParamsTy;
-    TypeId funcReturnTy;
-    //   - to represent the type of an array:
-    unsigned int arraySize;
-    TypeId arrayElemTy;
+    //   - the number of parameters of a function or the size of an array
+    unsigned int count;
+    //   - the return type of a function or the type of the elements
+    //     of an array
+    TypeId subTy;
+    //   - position in the ParamsPool of the first parameter of a function
+    std::size_t paramsPos;
 
   };  // class Type
 
@@ -27,129 +27,252 @@
 ////////////////////////////////////////////////////////////////
 
 #include <iostream>
+#include <sstream>
 #include <vector>
+#include <algorithm>
 #include "code.h"
 #include "LLVMCodeGen.h"
 
 using namespace std;
 
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'operand'
+
+namespace {
+
+  // spelling of the labels of each operand::LabelKind
+  const char *labelPrefix[] = {"while", "endwhile", "else_if_", "exit_if_"};
+
+  // set the positions of the instructions covered by the ranges (placed
+  // at offset). The ranges are nested, so the outer ones are applied
+  // first and the inner ones overwrite them
+  void fillPositions(std::vector<sourcePos> &positions, size_t offset,
+                     std::vector<instructionList::sourceRange> ranges) {
+    std::sort(ranges.begin(), ranges.end(),
+              [](const instructionList::sourceRange &r1, const instructionList::sourceRange &r2) {
+                return r1.begin < r2.begin or (r1.begin == r2.begin and r1.end > r2.end);
+              });
+    for (auto &r : ranges)
+      std::fill(positions.begin() + offset + r.begin, positions.begin() + offset + r.end, r.pos);
+  }
+
+}
+
+/// Constructors
+operand::operand() : kind(NONE), value(0) {}
+operand::operand(Kind k, uint32_t v) : kind(k), value(v) {}
+
+operand operand::temp(unsigned int n) { return operand(TEMP, n); }
+operand operand::integer(int n) { return operand(INT, uint32_t(n)); }
+/// the kind goes in the low bits, so the labels of a subroutine
+/// are small values and it can resolve them through a vector
+operand operand::label(LabelKind k, unsigned int n) { return operand(LABEL, n*4 + k); }
+
+operand::Kind operand::get_kind() const { return kind; }
+uint32_t operand::get_value() const { return value; }
+bool operand::empty() const { return kind == NONE; }
+
+/// all the spellings of a subroutine are interned once, so two operands
+/// are equal if they have the same kind and value
+bool operand::operator==(const operand &o) const { return kind == o.kind and value == o.value; }
+bool operand::operator!=(const operand &o) const { return not (*this == o); }
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'spellings'
+
+/// Constructors (a copy rebuilds words, that refers to its own index)
+spellings::spellings() {}
+spellings::spellings(const spellings &other) { *this = other; }
+spellings &spellings::operator=(const spellings &other) {
+  if (this == &other) return *this;
+  index = other.index;
+  words.assign(index.size(), nullptr);
+  for (auto &w : index) words[w.second] = &w.first;
+  return *this;
+}
+
+uint32_t spellings::intern(const std::string &s) {
+  auto ins = index.emplace(s, uint32_t(words.size()));
+  if (ins.second) words.push_back(&ins.first->first);
+  return ins.first->second;
+}
+
+operand spellings::name(const std::string &s) { return operand(operand::NAME, intern(s)); }
+operand spellings::floating(const std::string &s) { return operand(operand::FLOAT, intern(s)); }
+operand spellings::character(const std::string &s) { return operand(operand::CHAR, intern(s)); }
+operand spellings::text(const std::string &s) { return operand(operand::STRING, intern(s)); }
+
+/// the value is kept in the operand only if s is its usual spelling,
+/// so that the dump shows the constant as it was written
+operand spellings::integer(const std::string &s) {
+  uint64_t n = 0;
+  for (char c : s) {
+    n = n*10 + (c - '0');
+    if (n > 0x7fffffff) break;
+  }
+  if (n <= 0x7fffffff and s == std::to_string(n)) return operand::integer(int(n));
+  return operand(operand::DIGITS, intern(s));
+}
+
+operand spellings::copy_of(const operand &o, const spellings &from) {
+  switch (o.kind) {
+  case operand::NONE: case operand::TEMP: case operand::INT: case operand::LABEL:
+    return o;
+  default:
+    return operand(o.kind, intern(*from.words[o.value]));
+  }
+}
+
+operand spellings::find_name(const std::string &s) const {
+  auto it = index.find(s);
+  return it == index.end() ? operand() : operand(operand::NAME, it->second);
+}
+
+string spellings::str(const operand &o) const {
+  switch (o.kind) {
+  case operand::NONE:  return "";
+  case operand::TEMP:  return "%" + std::to_string(o.value);
+  case operand::INT:   return std::to_string(int(o.value));
+  case operand::LABEL: return labelPrefix[o.value % 4] + std::to_string(o.value / 4);
+  default:             return *words[o.value];
+  }
+}
+
+void spellings::dump(ostream &os, const operand &o) const {
+  switch (o.kind) {
+  case operand::NONE:  break;
+  case operand::TEMP:  os << '%' << o.value; break;
+  case operand::INT:   os << int(o.value); break;
+  case operand::LABEL: os << labelPrefix[o.value % 4] << o.value / 4; break;
+  default:             os << *words[o.value]; break;
+  }
+}
+
+
 ////////////////////////////////////////////////////////////////////
 /// Implementation for class 'instruction'
 
 /// Constructor
 instruction::instruction(Operation op,
-                         const std::string &a1, const std::string &a2, const std::string &a3) {
-  oper = op;
-  arg1 = a1;
-  arg2 = a2;
-  arg3 = a3;
-}
-
-instruction instruction::LABEL(const std::string &a1) { return instruction(_LABEL, a1); }
-instruction instruction::UJUMP(const std::string &a1) { return instruction(_UJUMP, a1); }
-instruction instruction::FJUMP(const std::string &a1, const std::string &a2) { return instruction(_FJUMP, a1, a2); }
-instruction instruction::HALT(const std::string &a1) { return instruction(_HALT, a1); }
-instruction instruction::PUSH(const std::string &a1) { return instruction(_PUSH, a1); }
-instruction instruction::POP(const std::string &a1) { return instruction(_POP, a1); }
-instruction instruction::CALL(const std::string &a1) { return instruction(_CALL, a1); }
+                         const operand &a1, const operand &a2, const operand &a3)
+  : oper(op), arg1(a1), arg2(a2), arg3(a3) {}
+
+instruction instruction::LABEL(const operand &a1) { return instruction(_LABEL, a1); }
+instruction instruction::UJUMP(const operand &a1) { return instruction(_UJUMP, a1); }
+instruction instruction::FJUMP(const operand &a1, const operand &a2) { return instruction(_FJUMP, a1, a2); }
+instruction instruction::HALT(const operand &a1) { return instruction(_HALT, a1); }
+instruction instruction::PUSH(const operand &a1) { return instruction(_PUSH, a1); }
+instruction instruction::POP(const operand &a1) { return instruction(_POP, a1); }
+instruction instruction::CALL(const operand &a1) { return instruction(_CALL, a1); }
 instruction instruction::RETURN() { return instruction(_RETURN); }
-instruction instruction::ADD(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_ADD, a1, a2, a3); }
-instruction instruction::SUB(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_SUB, a1, a2, a3); }
-instruction instruction::MUL(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_MUL, a1, a2, a3); }
-instruction instruction::DIV(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_DIV, a1, a2, a3); }
-instruction instruction::EQ(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_EQ, a1, a2, a3); }
-instruction instruction::LT(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_LT, a1, a2, a3); }
-instruction instruction::LE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_LE, a1, a2, a3); }
-instruction instruction::AND(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_AND, a1, a2, a3); }
-instruction instruction::OR(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_OR, a1, a2, a3); }
-instruction instruction::FADD(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FADD, a1, a2, a3); }
-instruction instruction::FSUB(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FSUB, a1, a2, a3); }
-instruction instruction::FMUL(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FMUL, a1, a2, a3); }
-instruction instruction::FDIV(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FDIV, a1, a2, a3); }
-instruction instruction::FEQ(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FEQ, a1, a2, a3); }
-instruction instruction::FLT(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FLT, a1, a2, a3); }
-instruction instruction::FLE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FLE, a1, a2, a3); }
-instruction instruction::NOT(const std::string &a1, const std::string &a2) { return instruction(_NOT, a1, a2); }
-instruction instruction::NEG(const std::string &a1, const std::string &a2) { return instruction(_NEG, a1, a2); }
-instruction instruction::FNEG(const std::string &a1, const std::string &a2) { return instruction(_FNEG, a1, a2); }
-instruction instruction::FLOAT(const std::string &a1, const std::string &a2) { return instruction(_FLOAT, a1, a2); }  
-instruction instruction::LOAD(const std::string &a1, const std::string &a2) { return instruction(_LOAD, a1, a2); }
-instruction instruction::ILOAD(const std::string &a1, const std::string &a2) { return instruction(_ILOAD, a1, a2); }
-instruction instruction::CHLOAD(const std::string &a1, const std::string &a2) { return instruction(_CHLOAD, a1, a2); }
-instruction instruction::FLOAD(const std::string &a1, const std::string &a2) { return instruction(_FLOAD, a1, a2); }
-instruction instruction::XLOAD(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_XLOAD, a1, a2, a3); }
-instruction instruction::LOADX(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_LOADX, a1, a2, a3); }
-instruction instruction::ALOAD(const std::string &a1, const std::string &a2) { return instruction(_ALOAD, a1, a2); }
-instruction instruction::LOADC(const std::string &a1, const std::string &a2) { return instruction(_LOADC, a1, a2); }
-instruction instruction::CLOAD(const std::string &a1, const std::string &a2) { return instruction(_CLOAD, a1, a2); }
-instruction instruction::READI(const std::string &a1) { return instruction(_READI, a1); }
-instruction instruction::READF(const std::string &a1) { return instruction(_READF, a1); }
-instruction instruction::READC(const std::string &a1) { return instruction(_READC, a1); }
-instruction instruction::WRITEI(const std::string &a1) { return instruction(_WRITEI, a1); }
-instruction instruction::WRITEF(const std::string &a1) { return instruction(_WRITEF, a1); }
-instruction instruction::WRITEC(const std::string &a1) { return instruction(_WRITEC, a1); }
-instruction instruction::WRITES(const std::string &a1) { return instruction(_WRITES, a1); }
+instruction instruction::ADD(const operand &a1, const operand &a2, const operand &a3) { return instruction(_ADD, a1, a2, a3); }
+instruction instruction::SUB(const operand &a1, const operand &a2, const operand &a3) { return instruction(_SUB, a1, a2, a3); }
+instruction instruction::MUL(const operand &a1, const operand &a2, const operand &a3) { return instruction(_MUL, a1, a2, a3); }
+instruction instruction::DIV(const operand &a1, const operand &a2, const operand &a3) { return instruction(_DIV, a1, a2, a3); }
+instruction instruction::EQ(const operand &a1, const operand &a2, const operand &a3) { return instruction(_EQ, a1, a2, a3); }
+instruction instruction::LT(const operand &a1, const operand &a2, const operand &a3) { return instruction(_LT, a1, a2, a3); }
+instruction instruction::LE(const operand &a1, const operand &a2, const operand &a3) { return instruction(_LE, a1, a2, a3); }
+instruction instruction::AND(const operand &a1, const operand &a2, const operand &a3) { return instruction(_AND, a1, a2, a3); }
+instruction instruction::OR(const operand &a1, const operand &a2, const operand &a3) { return instruction(_OR, a1, a2, a3); }
+instruction instruction::FADD(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FADD, a1, a2, a3); }
+instruction instruction::FSUB(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FSUB, a1, a2, a3); }
+instruction instruction::FMUL(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FMUL, a1, a2, a3); }
+instruction instruction::FDIV(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FDIV, a1, a2, a3); }
+instruction instruction::FEQ(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FEQ, a1, a2, a3); }
+instruction instruction::FLT(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FLT, a1, a2, a3); }
+instruction instruction::FLE(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FLE, a1, a2, a3); }
+instruction instruction::NOT(const operand &a1, const operand &a2) { return instruction(_NOT, a1, a2); }
+instruction instruction::NEG(const operand &a1, const operand &a2) { return instruction(_NEG, a1, a2); }
+instruction instruction::FNEG(const operand &a1, const operand &a2) { return instruction(_FNEG, a1, a2); }
+instruction instruction::FLOAT(const operand &a1, const operand &a2) { return instruction(_FLOAT, a1, a2); }  
+instruction instruction::LOAD(const operand &a1, const operand &a2) { return instruction(_LOAD, a1, a2); }
+instruction instruction::ILOAD(const operand &a1, const operand &a2) { return instruction(_ILOAD, a1, a2); }
+instruction instruction::CHLOAD(const operand &a1, const operand &a2) { return instruction(_CHLOAD, a1, a2); }
+instruction instruction::FLOAD(const operand &a1, const operand &a2) { return instruction(_FLOAD, a1, a2); }
+instruction instruction::XLOAD(const operand &a1, const operand &a2, const operand &a3) { return instruction(_XLOAD, a1, a2, a3); }
+instruction instruction::LOADX(const operand &a1, const operand &a2, const operand &a3) { return instruction(_LOADX, a1, a2, a3); }
+instruction instruction::ALOAD(const operand &a1, const operand &a2) { return instruction(_ALOAD, a1, a2); }
+instruction instruction::LOADC(const operand &a1, const operand &a2) { return instruction(_LOADC, a1, a2); }
+instruction instruction::CLOAD(const operand &a1, const operand &a2) { return instruction(_CLOAD, a1, a2); }
+instruction instruction::READI(const operand &a1) { return instruction(_READI, a1); }
+instruction instruction::READF(const operand &a1) { return instruction(_READF, a1); }
+instruction instruction::READC(const operand &a1) { return instruction(_READC, a1); }
+instruction instruction::WRITEI(const operand &a1) { return instruction(_WRITEI, a1); }
+instruction instruction::WRITEF(const operand &a1) { return instruction(_WRITEF, a1); }
+instruction instruction::WRITEC(const operand &a1) { return instruction(_WRITEC, a1); }
+instruction instruction::WRITES(const operand &a1) { return instruction(_WRITES, a1); }
 instruction instruction::WRITELN() { return instruction(_WRITELN); }
 instruction instruction::NOOP() { return instruction(_NOOP); }
 
 
-/// Destructor
-instruction::~instruction() {}
+string instruction::dump(const spellings &words) const {
+  ostringstream s;
+  dump(s, words);
+  return s.str();
+}
+
+void instruction::dump(ostream &os, const spellings &words) const {
+  // infix operator of the binary instructions
+  const char *op = nullptr;
+  switch (oper) {
+  case instruction::_ADD : op = " + "; break;
+  case instruction::_SUB : op = " - "; break;
+  case instruction::_MUL : op = " * "; break;
+  case instruction::_DIV : op = " / "; break;
+  case instruction::_AND : op = " and "; break;
+  case instruction::_OR : op = " or "; break;
+  case instruction::_EQ : op = " == "; break;
+  case instruction::_LT : op = " < "; break;
+  case instruction::_LE : op = " <= "; break;
+  case instruction::_FADD : op = " +. "; break;
+  case instruction::_FSUB : op = " -. "; break;
+  case instruction::_FMUL : op = " *. "; break;
+  case instruction::_FDIV : op = " /. "; break;
+  case instruction::_FEQ : op = " ==. "; break;
+  case instruction::_FLT : op = " <. "; break;
+  case instruction::_FLE : op = " <=. "; break;
+  default : break;
+  }
+  if (op) {
+    os << "   "; words.dump(os, arg1); os << " = "; words.dump(os, arg2); os << op; words.dump(os, arg3);
+    return;
+  }
 
-string instruction::dump() const {
-  string s;
-  string ind="   ";
+  if (oper != instruction::_LABEL) os << "   ";
   switch (oper) {
-  case instruction::_LABEL : { s = "label " + arg1 + " :"; ind = ""; break; }
-  case instruction::_UJUMP : { s = "goto " + arg1; break; }
-  case instruction::_FJUMP : { s = "ifFalse " + arg1 + " goto " +arg2; break; }
-  case instruction::_HALT  : { s = "halt \"" + arg1 + "\""; break; }
+  case instruction::_LABEL : { os << "label "; words.dump(os, arg1); os << " :"; break; }
+  case instruction::_UJUMP : { os << "goto "; words.dump(os, arg1); break; }
+  case instruction::_FJUMP : { os << "ifFalse "; words.dump(os, arg1); os << " goto "; words.dump(os, arg2); break; }
+  case instruction::_HALT  : { os << "halt \""; words.dump(os, arg1); os << "\""; break; }
   case instruction::_LOAD  : 
   case instruction::_FLOAD : 
-  case instruction::_ILOAD : { s = arg1 + " = " + arg2; break; } 
-  case instruction::_CHLOAD : { s = arg1 + " = '" + arg2 +"'"; break; } 
-  case instruction::_PUSH : { s = "pushparam " + (arg1.empty()? "" : arg1); break; }
-  case instruction::_POP : { s = "popparam " + (arg1.empty()? "" : arg1); break; }
-  case instruction::_CALL : { s = "call " + arg1; break; }
-  case instruction::_RETURN : { s = "return"; break; }
-  case instruction::_XLOAD : { s = arg1 + "[" + arg2 + "] = " + arg3; break; }
-  case instruction::_LOADX : { s = arg1 + " = " + arg2 + "[" + arg3 + "]"; break; }
-  case instruction::_ALOAD : { s = arg1 + " = &" + arg2; break; }
-  case instruction::_LOADC : { s = arg1 + " = *" + arg2; break; }
-  case instruction::_CLOAD : { s = "*" + arg1 + " = " + arg2; break; }
-  case instruction::_READI : { s = "readi " + arg1; break; }
-  case instruction::_READF : { s = "readf " + arg1; break; }
-  case instruction::_READC : { s = "readc " + arg1; break; }
-  case instruction::_WRITEI : { s = "writei " + arg1; break; }
-  case instruction::_WRITEF : { s = "writef " + arg1; break; }
-  case instruction::_WRITEC : { s = "writec " + arg1; break; }
-  case instruction::_WRITES : { s = "writes " + arg1; break; }
-  case instruction::_WRITELN : { s = "writeln"; break; }
-  case instruction::_ADD : { s = arg1 + " = " + arg2 + " + " + arg3; break; }
-  case instruction::_SUB : { s = arg1 + " = " + arg2 + " - " + arg3; break; }
-  case instruction::_MUL : { s = arg1 + " = " + arg2 + " * " + arg3; break; }
-  case instruction::_DIV : { s = arg1 + " = " + arg2 + " / " + arg3; break; }
-  case instruction::_AND : { s = arg1 + " = " + arg2 + " and " + arg3; break; }
-  case instruction::_OR : { s = arg1 + " = " + arg2 + " or " + arg3; break; }
-  case instruction::_EQ : { s = arg1 + " = " + arg2 + " == " + arg3; break; }
-  case instruction::_LT : { s = arg1 + " = " + arg2 + " < " + arg3; break; }
-  case instruction::_LE : { s = arg1 + " = " + arg2 + " <= " + arg3; break; }
-  case instruction::_NOT : { s = arg1 + " = not " + arg2; break; }
-  case instruction::_NEG : { s = arg1 + " = - " + arg2; break; }
-  case instruction::_FADD : { s = arg1 + " = " + arg2 + " +. " + arg3; break; }
-  case instruction::_FSUB : { s = arg1 + " = " + arg2 + " -. " + arg3; break; }
-  case instruction::_FMUL : { s = arg1 + " = " + arg2 + " *. " + arg3; break; }
-  case instruction::_FDIV : { s = arg1 + " = " + arg2 + " /. " + arg3; break; }
-  case instruction::_FEQ : { s = arg1 + " = " + arg2 + " ==. " + arg3; break; }
-  case instruction::_FLT : { s = arg1 + " = " + arg2 + " <. " + arg3; break; }
-  case instruction::_FLE : { s =  arg1 + " = " + arg2 + " <=. " + arg3; break; }
-  case instruction::_FNEG : { s =  arg1 + " = -. " + arg2; break; }
-  case instruction::_FLOAT : { s = arg1 + " = float " + arg2; break; }
-  case instruction::_NOOP : { s = "noop"; break; }
-  default : { s = "????"; break; }
+  case instruction::_ILOAD : { words.dump(os, arg1); os << " = "; words.dump(os, arg2); break; } 
+  case instruction::_CHLOAD : { words.dump(os, arg1); os << " = '"; words.dump(os, arg2); os << "'"; break; } 
+  case instruction::_PUSH : { os << "pushparam "; words.dump(os, arg1); break; }
+  case instruction::_POP : { os << "popparam "; words.dump(os, arg1); break; }
+  case instruction::_CALL : { os << "call "; words.dump(os, arg1); break; }
+  case instruction::_RETURN : { os << "return"; break; }
+  case instruction::_XLOAD : { words.dump(os, arg1); os << "["; words.dump(os, arg2); os << "] = "; words.dump(os, arg3); break; }
+  case instruction::_LOADX : { words.dump(os, arg1); os << " = "; words.dump(os, arg2); os << "["; words.dump(os, arg3); os << "]"; break; }
+  case instruction::_ALOAD : { words.dump(os, arg1); os << " = &"; words.dump(os, arg2); break; }
+  case instruction::_LOADC : { words.dump(os, arg1); os << " = *"; words.dump(os, arg2); break; }
+  case instruction::_CLOAD : { os << "*"; words.dump(os, arg1); os << " = "; words.dump(os, arg2); break; }
+  case instruction::_READI : { os << "readi "; words.dump(os, arg1); break; }
+  case instruction::_READF : { os << "readf "; words.dump(os, arg1); break; }
+  case instruction::_READC : { os << "readc "; words.dump(os, arg1); break; }
+  case instruction::_WRITEI : { os << "writei "; words.dump(os, arg1); break; }
+  case instruction::_WRITEF : { os << "writef "; words.dump(os, arg1); break; }
+  case instruction::_WRITEC : { os << "writec "; words.dump(os, arg1); break; }
+  case instruction::_WRITES : { os << "writes "; words.dump(os, arg1); break; }
+  case instruction::_WRITELN : { os << "writeln"; break; }
+  case instruction::_NOT : { words.dump(os, arg1); os << " = not "; words.dump(os, arg2); break; }
+  case instruction::_NEG : { words.dump(os, arg1); os << " = - "; words.dump(os, arg2); break; }
+  case instruction::_FNEG : { words.dump(os, arg1); os << " = -. "; words.dump(os, arg2); break; }
+  case instruction::_FLOAT : { words.dump(os, arg1); os << " = float "; words.dump(os, arg2); break; }
+  case instruction::_NOOP : { os << "noop"; break; }
+  default : { os << "????"; break; }
   }
-
-  return ind + s;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -167,21 +290,65 @@ instructionList instruction::operator||(const instructionList &lst) const {
 instructionList::instructionList() {}
 // constructor from a single instruction
 instructionList::instructionList(const instruction &inst) { this->push_back(inst); }
-// destructor
-instructionList::~instructionList() {}
+
+// the instructions from 'from' on come from the statement at pos
+void instructionList::set_source(size_t from, const sourcePos &pos) {
+  if (from < size()) sources.push_back({from, size(), pos});
+}
+
+// append the ranges of a list placed at offset
+void instructionList::append_sources(const std::vector<sourceRange> &srcs, size_t offset) {
+  for (auto &r : srcs)
+    sources.push_back({r.begin + offset, r.end + offset, r.pos});
+}
 
 // concatenation of lists (or list+instruction, via automatic coertion)
-instructionList instructionList::operator||(const instructionList &lst) const {
-  instructionList newlist = (*this);
+instructionList instructionList::operator||(const instructionList &lst) const & {
+  instructionList newlist;
+  newlist.reserve(size() + lst.size());
+  newlist.insert(newlist.end(), begin(), end());
   newlist.insert(newlist.end(), lst.begin(), lst.end());
+  newlist.sources = sources;
+  newlist.append_sources(lst.sources, size());
   return newlist;
 }
+// the left list is a temporary: append in place and move the result
+instructionList instructionList::operator||(const instructionList &lst) && {
+  *this += lst;
+  return std::move(*this);
+}
+instructionList instructionList::operator||(instructionList &&lst) && {
+  *this += std::move(lst);
+  return std::move(*this);
+}
+
+// append lst at the end of this list
+instructionList &instructionList::operator+=(const instructionList &lst) {
+  append_sources(lst.sources, size());
+  insert(end(), lst.begin(), lst.end());
+  return *this;
+}
+// lst is a temporary: if this list is empty, take its buffers
+instructionList &instructionList::operator+=(instructionList &&lst) {
+  if (empty() and sources.empty())
+    sources.swap(lst.sources);
+  else
+    append_sources(lst.sources, size());
+  if (empty())
+    std::vector<instruction>::swap(lst);
+  else
+    insert(end(), lst.begin(), lst.end());
+  return *this;
+}
 
 // print instructionList (for debugging)
-string instructionList::dump() const {
-  string s;  
-  for (auto i : *this ) s += i.dump() + "\n";
-  return s;
+string instructionList::dump(const spellings &words) const {
+  ostringstream s;
+  dump(s, words);
+  return s.str();
+}
+void instructionList::dump(ostream &os, const spellings &words) const {
+  for (auto &i : *this) { i.dump(os, words); os << '\n'; }
 }
 
 
@@ -195,86 +362,149 @@ var::var(const std::string &n, const std::string &t, size_t ne) {
   nelem = ne;
 }
 
-/// destructor
-var::~var() {}
-
 /// print (for debugging)
 string var::dump() const {
-  
-  if (nelem == 0) // if it is a parameter, name and type (unless LLVM wants it differnt)
-    return name + " " + type;
-  else {
-    // local var: name + type (plus size for arrays)
-    string s = name + " " + type;
-    if (nelem > 1) s += " " + std::to_string(nelem);
-    return s;
-  }
+  ostringstream s;
+  dump(s);
+  return s.str();
+}
+void var::dump(ostream &os) const {
+  // parameter (nelem == 0) or local var: name + type,
+  // plus size for arrays
+  os << name << ' ' << type;
+  if (nelem > 1) os << ' ' << nelem;
 }
 
 ////////////////////////////////////////////////////////////////////
 /// Implementation for class 'subroutine'
 
+/// program counter of a label not found
+const size_t subroutine::NO_PC;
+
 /// constructor
 subroutine::subroutine(const string &sname) { name = sname; }
-/// destructor
-subroutine::~subroutine() {}
 /// get subroutine name
 string subroutine::get_name() const { return name; };
 /// add new variable
-void subroutine::add_var(const var &v) { vars.push_back(v); }
+void subroutine::add_var(const var &v) { words.name(v.name); vars.push_back(v); }
 /// add new variable
-void subroutine::add_var(const std::string &name, const std::string &type, size_t sz) { vars.push_back(var(name,type,sz)); }
+void subroutine::add_var(const std::string &name, const std::string &type, size_t sz) { add_var(var(name,type,sz)); }
 /// add new parameter
 void subroutine::add_param(const std::string &name, const std::string &type, bool isarray) {
   std::string t1 = (not isarray ? type : type+" array");
+  words.name(name);
   params.push_back(var(name,t1,0));
 }
 /// add new instruction
 void subroutine::add_instruction(const instruction &inst) {
-  if (inst.oper == instruction::_LABEL) labels.insert(make_pair(inst.arg1,instructions.size()));
+  if (inst.oper == instruction::_LABEL) {
+    uint32_t lab = inst.arg1.get_value();
+    if (lab >= labels.size()) labels.resize(lab+1, NO_PC);
+    labels[lab] = instructions.size();
+  }
   instructions.push_back(inst);
+  positions.push_back(sourcePos());
 }
 /// add instruction list to current instructions
 void subroutine::add_instructions(const instructionList &lins) {
-  for (auto i : lins)
+  size_t offset = instructions.size();
+  for (auto &i : lins)
     this->add_instruction(i);
+  fillPositions(positions, offset, lins.sources);
 }
 /// set instruction list (overwritting current instructions)
 void subroutine::set_instructions(const instructionList &lins) {
   instructions.clear();
+  labels.clear();
+  positions.clear();
   this->add_instructions(lins);
 }
+void subroutine::set_instructions(instructionList &&lins) {
+  instructions = std::move(lins);
+  index_labels();
+  positions.assign(instructions.size(), sourcePos());
+  fillPositions(positions, 0, std::move(instructions.sources));
+  instructions.sources.clear();
+}
+/// replace the instruction at pc
+void subroutine::set_instruction_at(size_t pc, const instruction &inst) {
+  bool relabel = instructions[pc].oper == instruction::_LABEL or inst.oper == instruction::_LABEL;
+  instructions[pc] = inst;
+  if (relabel) index_labels();
+}
+/// remove the marked instructions
+void subroutine::remove_instructions(const std::vector<bool> &removed) {
+  size_t kept = 0;
+  for (size_t pc = 0; pc < instructions.size(); ++pc) {
+    if (pc < removed.size() and removed[pc]) continue;
+    instructions[kept] = instructions[pc];
+    positions[kept] = positions[pc];
+    ++kept;
+  }
+  instructions.erase(instructions.begin() + kept, instructions.end());
+  positions.resize(kept);
+  index_labels();
+}
+/// fill labels from the instructions
+void subroutine::index_labels() {
+  labels.clear();
+  for (size_t pc = 0; pc < instructions.size(); ++pc) {
+    if (instructions[pc].oper != instruction::_LABEL) continue;
+    uint32_t lab = instructions[pc].arg1.get_value();
+    if (lab >= labels.size()) labels.resize(lab+1, NO_PC);
+    labels[lab] = pc;
+  }
+}
 /// get instruction at given program counter
 instruction subroutine::get_instruction_at(size_t pc) const {
   if (pc>=instructions.size()) return instruction(instruction::_INVALID);
   return instructions[pc];
 }
 /// get program counter for given label
-size_t subroutine::get_label_pc(std::string &lab) const { return labels.find(lab)->second; }
-/// get the list of instructions (needed only in LLVMCodeGen)
-instructionList subroutine::get_instructions() const {
+size_t subroutine::get_label_pc(const operand &lab) const {
+  return lab.get_value() < labels.size() ? labels[lab.get_value()] : NO_PC;
+}
+/// get source position of the instruction at given program counter
+sourcePos subroutine::get_source_position(size_t pc) const {
+  return pc < positions.size() ? positions[pc] : sourcePos();
+}
+/// get the list of instructions (for LLVMCodeGen and the analyses)
+const instructionList &subroutine::get_instructions() const {
   return instructions;
 }
+/// get the spellings of the operands
+spellings &subroutine::get_spellings() { return words; }
+const spellings &subroutine::get_spellings() const { return words; }
 /// print (for debugging)
-string subroutine::dump() const {
-  string s;
-  s = "function " + name + "\n";
+string subroutine::dump(bool sourceComments) const {
+  ostringstream s;
+  dump(s, sourceComments);
+  return s.str();
+}
+void subroutine::dump(ostream &os, bool sourceComments) const {
+  os << "function " << name << '\n';
   if (not params.empty()) {
-    s += "  params\n" ;
-    for (auto p : params) s += "    " + p.dump() + "\n";
-    s += "  endparams\n\n";
+    os << "  params\n" ;
+    for (auto &p : params) { os << "    "; p.dump(os); os << '\n'; }
+    os << "  endparams\n\n";
   }
   if (not vars.empty()) {
-    s += "  vars\n";
-    for (auto v : vars) s += "    " + v.dump() + "\n";
-    s += "  endvars\n\n";
+    os << "  vars\n";
+    for (auto &v : vars) { os << "    "; v.dump(os); os << '\n'; }
+    os << "  endvars\n\n";
   }
 
-  string ind = "  ";
-  if (labels.empty()) ind="";
-  for (auto i : instructions) s += ind + i.dump() + "\n";  
-  s += "endfunction\n\n";
-  return s;
+  const char *ind = labels.empty() ? "" : "  ";
+  sourcePos prev;
+  for (size_t pc = 0; pc < instructions.size(); ++pc) {
+    const sourcePos &pos = positions[pc];
+    if (sourceComments and pos.line != 0 and
+        (pos.line != prev.line or pos.column != prev.column))
+      os << ind << "   ;;; " << pos.line << ':' << pos.column << '\n';
+    prev = pos;
+    os << ind; instructions[pc].dump(os, words); os << '\n';
+  }
+  os << "endfunction\n\n";
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -287,8 +517,6 @@ const string code::INVALID_FLOAT_OPERAND = "Invalid float value in math operatio
 
 /// constructor
 code::code() {};
-/// destructor
-code::~code() {};
 
 /// get most recently added subroutine 
 subroutine& code::get_last_subroutine() { return subs[subs.size()-1]; }
@@ -302,33 +530,56 @@ void code::add_subroutine(const subroutine &s) {
   subs.push_back(s);
   names.insert(make_pair(s.get_name(), subs.size()-1));
 }
-/// get the list of subroutine's (needed only in LLVMCodeGen)
+void code::add_subroutine(subroutine &&s) {
+  subs.push_back(std::move(s));
+  names.insert(make_pair(subs.back().get_name(), subs.size()-1));
+}
+/// get the list of subroutine's (for LLVMCodeGen and the passes)
 const std::vector<subroutine> & code::get_subroutine_list() const {
   return subs;
 }
+std::vector<subroutine> & code::get_subroutine_list() {
+  return subs;
+}
+/// remove a subroutine (the index of the ones after it is updated)
+void code::remove_subroutine(const string &name) {
+  auto it = names.find(name);
+  if (it == names.end()) return;
+  subs.erase(subs.begin() + it->second);
+  names.clear();
+  for (size_t i = 0; i < subs.size(); ++i)
+    names.insert(make_pair(subs[i].get_name(), i));
+}
 /// print (for debugging)
-string code::dump() const {
-  string c;
-  for (auto s : subs) c += s.dump();
-  return c;
+string code::dump(bool sourceComments) const {
+  ostringstream c;
+  dump(c, sourceComments);
+  return c.str();
+}
+void code::dump(ostream &os, bool sourceComments) const {
+  for (auto &s : subs) s.dump(os, sourceComments);
 }
 /// print the code in LLVM IR
-std::string code::dumpLLVM(const TypesMgr & Types, const SymTable & Symbols) const {
-  LLVMCodeGen llvmCode(Types, Symbols, *this);
+std::string code::dumpLLVM(const TypesMgr & Types, const SymTable & Symbols,
+                           bool sourceComments) const {
+  LLVMCodeGen llvmCode(Types, Symbols, *this, sourceComments);
   std::string llvmStr = llvmCode.dumpLLVM();
   return llvmStr;
 }
+void code::dumpLLVM(const TypesMgr & Types, const SymTable & Symbols, std::ostream &os,
+                    bool sourceComments) const {
+  LLVMCodeGen llvmCode(Types, Symbols, *this, sourceComments);
+  llvmCode.dumpLLVM(os);
+}
 
 
 ////////////////////////////////////////////////////////////////////
-/// Static methods to manage counters
-int counters::countIF = 0;
-int counters::countWHILE = 0;
-int counters::countTEMP = 0;
-
-string counters::newLabelIF() { return std::to_string(++countIF); }
-string counters::newLabelWHILE() { return std::to_string(++countWHILE); }
-string counters::newTEMP() { return std::to_string(++countTEMP); }
+/// Methods to manage counters
+counters::counters() : countIF(0), countWHILE(0), countTEMP(0) {}
+
+unsigned int counters::newLabelIF() { return ++countIF; }
+unsigned int counters::newLabelWHILE() { return ++countWHILE; }
+operand counters::newTEMP() { return operand::temp(++countTEMP); }
 
 void counters::resetLabelIF() { countIF = 0; }
 void counters::resetLabelWHILE() { countWHILE = 0; }
@@ -30,22 +30,118 @@
 
 #include <map>
 #include <list>
+#include <string>
 #include <vector>
+#include <iosfwd>
+#include <unordered_map>
+#include <cstdint>
 #include "TypesMgr.h"
 #include "SymTable.h"
 
 
 /// predeclaration
 class instructionList;
+class spellings;
 class LLVMCodeGen;
 
+////////////////////////////////////////////////////////////////////
+/// Class operand stores an argument of an instruction as a tagged
+/// handle: the kind of the argument and a 32-bit value. Temporaries
+/// (%N), integer constants and labels are kept in the value itself;
+/// the other spellings (names, float and char constants, strings,
+/// and the integer constants that must keep their digits) are
+/// interned in the spellings of the subroutine that holds the
+/// instruction, and the value is their position there. Operands are
+/// trivially copyable, and the spelling of an operand is only built
+/// when the code is dumped.
+
+class operand {
+public:
+  /// kinds of operands
+  /// (DIGITS is an integer constant spelled as in the source, when
+  /// the spelling is not the value: 007, or too big for an int)
+  typedef enum : unsigned char {NONE, TEMP, NAME, LABEL, INT, DIGITS, FLOAT, CHAR, STRING} Kind;
+  /// kinds of labels generated for the control statements
+  typedef enum : unsigned char {WHILE, ENDWHILE, ELSE_IF, EXIT_IF} LabelKind;
+
+  /// constructor of an empty operand
+  operand();
+
+  /// ------ constructors for the kinds that need no spelling -------
+  static operand temp(unsigned int n);
+  static operand integer(int n);
+  static operand label(LabelKind k, unsigned int n);
+
+  /// kind and value of the operand
+  Kind get_kind() const;
+  std::uint32_t get_value() const;
+  bool empty() const;
+
+  /// comparison of operands (same kind and same spelling, when both
+  /// come from the same spellings)
+  bool operator==(const operand &o) const;
+  bool operator!=(const operand &o) const;
+
+private:
+  friend class spellings;
+  operand(Kind k, std::uint32_t v);
+
+  Kind kind;
+  std::uint32_t value;
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Class spellings interns the spellings of the operands of a
+/// subroutine. Each subroutine owns its own, so they are freed with
+/// it and the threads that translate different functions do not
+/// share them.
+
+class spellings {
+public:
+  spellings();
+  spellings(const spellings &other);
+  spellings(spellings &&other) = default;
+  spellings &operator=(const spellings &other);
+  spellings &operator=(spellings &&other) = default;
+
+  /// ------ constructors for the kinds of operands with a spelling -------
+  operand name(const std::string &s);
+  /// an integer constant: INT if s is the spelling of its value,
+  /// DIGITS otherwise (so it is dumped as written)
+  operand integer(const std::string &s);
+  operand floating(const std::string &s);
+  operand character(const std::string &s);
+  operand text(const std::string &s);
+  /// the same operand of another spellings, interned in this one
+  operand copy_of(const operand &o, const spellings &from);
+
+  /// the NAME operand with this spelling, or an empty operand if
+  /// the name has not been interned
+  operand find_name(const std::string &s) const;
+
+  /// spelling of an operand
+  std::string str(const operand &o) const;
+  /// write the spelling of an operand to os (with no copies)
+  void dump(std::ostream &os, const operand &o) const;
+
+private:
+  std::uint32_t intern(const std::string &s);
+
+  /// the keys of the index are the spellings, that do not move when
+  /// the index grows, so words refers to them
+  std::unordered_map<std::string, std::uint32_t> index;
+  std::vector<const std::string *> words;
+};
+
+
 ////////////////////////////////////////////////////////////////////
 /// Class instruction stores a VM instruction code with its operands
 
 class instruction {
 public:
   /// instruction codes
-  typedef enum {_LABEL, _UJUMP, _FJUMP, _HALT, _PUSH, _POP, _CALL, _RETURN,
+  typedef enum : unsigned char {_LABEL, _UJUMP, _FJUMP, _HALT, _PUSH, _POP, _CALL, _RETURN,
                 _ADD, _SUB, _MUL, _DIV, _EQ, _LT, _LE, _NEG, _NOT, _AND, _OR, _FLOAT,
                 _FADD, _FSUB, _FMUL, _FDIV, _FEQ, _FLT, _FLE, _FNEG,
                 _LOAD, _ILOAD, _CHLOAD, _FLOAD, _XLOAD, _LOADX, _ALOAD, _LOADC, _CLOAD,
@@ -54,14 +150,11 @@ public:
   /// instruction code
   Operation oper;
   /// arguments
-  std::string arg1, arg2, arg3;
+  operand arg1, arg2, arg3;
   
   /// constructor
   instruction(Operation op,
-              const std::string &a1="", const std::string &a2="", const std::string &a3="");
-
-  /// destructor
-  ~instruction();
+              const operand &a1=operand(), const operand &a2=operand(), const operand &a3=operand());
 
   // concatenation of instruction+list (or instruction+instruction, via automatic coertion)
   instructionList operator||(const instructionList &lst) const;
@@ -69,100 +162,111 @@ public:
   /// ------ specific constructors for each instruction -------
 
   // create new instruction "a1 :"
-  static instruction LABEL(const std::string &a1);
+  static instruction LABEL(const operand &a1);
   // create new instruction "goto a1"
-  static instruction UJUMP(const std::string &a1);
+  static instruction UJUMP(const operand &a1);
   // create new instruction "ifFalse a1 goto a2"
-  static instruction FJUMP(const std::string &a1, const std::string &a2);
+  static instruction FJUMP(const operand &a1, const operand &a2);
   // create new instruction "halt"
-  static instruction HALT(const std::string &a1="");
+  static instruction HALT(const operand &a1=operand());
   // create new instruction "pushparam a1"
-  static instruction PUSH(const std::string &a1="");
+  static instruction PUSH(const operand &a1=operand());
   // create new instruction "popparam a1"
-  static instruction POP(const std::string &a1="");
+  static instruction POP(const operand &a1=operand());
   // create new instruction "call a1"
-  static instruction CALL(const std::string &a1);
+  static instruction CALL(const operand &a1);
   // create new instruction "return"
   static instruction RETURN();
   // create new instruction "a1 = a2 + a3"
-  static instruction ADD(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction ADD(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 - a3"
-  static instruction SUB(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction SUB(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 * a3"
-  static instruction MUL(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction MUL(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 / a3"
-  static instruction DIV(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction DIV(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 == a3"
-  static instruction EQ(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction EQ(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 < a3"
-  static instruction LT(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction LT(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 <= a3"
-  static instruction LE(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction LE(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 and a3"
-  static instruction AND(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction AND(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 or a3"
-  static instruction OR(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction OR(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 +. a3"
-  static instruction FADD(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FADD(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 -. a3"
-  static instruction FSUB(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FSUB(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 *. a3"
-  static instruction FMUL(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FMUL(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 /. a3"
-  static instruction FDIV(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FDIV(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 ==. a3"
-  static instruction FEQ(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FEQ(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 <. a3"
-  static instruction FLT(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FLT(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 <=. a3"
-  static instruction FLE(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FLE(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = not a2"
-  static instruction NOT(const std::string &a1, const std::string &a2);
+  static instruction NOT(const operand &a1, const operand &a2);
   // create new instruction "a1 = - a2"
-  static instruction NEG(const std::string &a1, const std::string &a2);
+  static instruction NEG(const operand &a1, const operand &a2);
   // create new instruction "a1 = -. a2"
-  static instruction FNEG(const std::string &a1, const std::string &a2);
+  static instruction FNEG(const operand &a1, const operand &a2);
   // create new instruction "a1 = float a2"
-  static instruction FLOAT(const std::string &a1, const std::string &a2);  
+  static instruction FLOAT(const operand &a1, const operand &a2);  
   // create new instruction "a1 = a2"
-  static instruction LOAD(const std::string &a1, const std::string &a2);
+  static instruction LOAD(const operand &a1, const operand &a2);
   // create new instruction "a1 = a2" (where a2 is an integer constant)
-  static instruction ILOAD(const std::string &a1, const std::string &a2);
+  static instruction ILOAD(const operand &a1, const operand &a2);
   // create new instruction "a1 = a2" (where a2 is a character constant)
-  static instruction CHLOAD(const std::string &a1, const std::string &a2);
+  static instruction CHLOAD(const operand &a1, const operand &a2);
   // create new instruction "a1 = a2" (where a2 is a float constant)
-  static instruction FLOAD(const std::string &a1, const std::string &a2);
+  static instruction FLOAD(const operand &a1, const operand &a2);
   // create new instruction "a1[a2] = a3" 
-  static instruction XLOAD(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction XLOAD(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2[a3]" 
-  static instruction LOADX(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction LOADX(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = &a2" 
-  static instruction ALOAD(const std::string &a1, const std::string &a2);
+  static instruction ALOAD(const operand &a1, const operand &a2);
   // create new instruction "a1 = *a2" 
-  static instruction LOADC(const std::string &a1, const std::string &a2);
+  static instruction LOADC(const operand &a1, const operand &a2);
   // create new instruction "*a1 = a2" 
-  static instruction CLOAD(const std::string &a1, const std::string &a2);
+  static instruction CLOAD(const operand &a1, const operand &a2);
   // create new instruction "readi a1" 
-  static instruction READI(const std::string &a1);
+  static instruction READI(const operand &a1);
   // create new instruction "readf a1" 
-  static instruction READF(const std::string &a1);
+  static instruction READF(const operand &a1);
   // create new instruction "readc a1" 
-  static instruction READC(const std::string &a1);
+  static instruction READC(const operand &a1);
   // create new instruction "writei a1" 
-  static instruction WRITEI(const std::string &a1); 
+  static instruction WRITEI(const operand &a1); 
   // create new instruction "writef a1" 
-  static instruction WRITEF(const std::string &a1);
+  static instruction WRITEF(const operand &a1);
   // create new instruction "writec a1" 
-  static instruction WRITEC(const std::string &a1);
+  static instruction WRITEC(const operand &a1);
   // create new instruction "writes 'string constant'" 
-  static instruction WRITES(const std::string &a1);
+  static instruction WRITES(const operand &a1);
   // create new instruction "writeln" 
   static instruction WRITELN();
   // create new instruction "noop" (not really needed) 
   static instruction NOOP();
   
-  // print instruction
-  std::string dump() const;   
+  // print instruction (its operands are spelled by words)
+  std::string dump(const spellings &words) const;
+  void dump(std::ostream &os, const spellings &words) const;
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Struct sourcePos stores a position (line and column) in the source
+/// program. Line 0 means that the position is unknown.
+
+struct sourcePos {
+  std::uint32_t line = 0;
+  std::uint32_t column = 0;
 };
 
 
@@ -171,18 +275,43 @@ public:
 
 class instructionList : public std::vector<instruction> {
 public:
+  /// the instructions in [begin, end) were generated by the statement
+  /// at pos. Ranges nest like the statements that generate them
+  struct sourceRange {
+    std::size_t begin, end;
+    sourcePos pos;
+  };
+  /// source ranges of the list (shifted when the list is appended
+  /// to another one)
+  std::vector<sourceRange> sources;
+
   // constructor
   instructionList();
   // constructor from a single instruction
   instructionList(const instruction &);
-  // destructor
-  ~instructionList();
 
-  // concatenation of lists (or list+instruction, via automatic coertion)
-  instructionList operator||(const instructionList &lst) const;
+  // the instructions from position 'from' to the end of the list
+  // come from the statement at pos
+  void set_source(std::size_t from, const sourcePos &pos);
 
-  // print instructionList
-  std::string dump() const;   
+  // concatenation of lists (or list+instruction, via automatic coertion).
+  // When the left list is a temporary, lst is appended to it in place,
+  // so a chain a || b || c || ... takes linear time
+  instructionList operator||(const instructionList &lst) const &;
+  instructionList operator||(const instructionList &lst) &&;
+  instructionList operator||(instructionList &&lst) &&;
+
+  // append lst at the end of this list
+  instructionList &operator+=(const instructionList &lst);
+  instructionList &operator+=(instructionList &&lst);
+
+  // print instructionList (its operands are spelled by words)
+  std::string dump(const spellings &words) const;
+  void dump(std::ostream &os, const spellings &words) const;
+
+private:
+  // append the ranges of another list that is placed at offset
+  void append_sources(const std::vector<sourceRange> &srcs, std::size_t offset);
 };
 
 
@@ -196,10 +325,10 @@ public:
   size_t nelem;
 
   var(const std::string &name, const std::string &type, size_t nelem=1);
-  ~var();
 
   // print var
   std::string dump() const; 
+  void dump(std::ostream &os) const;
 };
 
 
@@ -213,18 +342,29 @@ private:
   std::string name;
   /// instructions
   instructionList instructions;
-  /// map label name -> position in instructions
-  std::map<std::string, size_t> labels;
+  /// spellings of the operands of the instructions
+  spellings words;
+  /// label (value of the operand) -> position in instructions
+  /// (NO_PC if the label is not in this subroutine)
+  std::vector<size_t> labels;
+  /// source position of each instruction (line 0 if unknown), taken
+  /// from the innermost statement that generated it
+  std::vector<sourcePos> positions;
+
+  /// fill labels from the instructions
+  void index_labels();
 
 public:
+  /// program counter of a label not found
+  static const size_t NO_PC = size_t(-1);
+
   /// list of local variables
   std::list<var> vars;
   /// list of params
   std::list<var> params;  
 
-  /// constructor and destructor
+  /// constructor (no destructor is declared, so subroutines can be moved)
   subroutine(const std::string &sname);
-  ~subroutine();
 
   /// get subroutine name
   std::string get_name() const;
@@ -240,16 +380,31 @@ public:
   void add_instructions(const instructionList &lins);
   /// set instruction list (overwritting current instructions)
   void set_instructions(const instructionList &lins);
+  void set_instructions(instructionList &&lins);
+  /// replace the instruction at given program counter (it keeps the
+  /// source position of the old one)
+  void set_instruction_at(size_t pc, const instruction &inst);
+  /// remove the instructions whose program counter is marked in
+  /// removed (the others keep their source positions)
+  void remove_instructions(const std::vector<bool> &removed);
   
   /// get instruction at given program counter in subroutine
   instruction get_instruction_at(size_t pc) const;
   /// get program counter in subroutine for given label
-  size_t get_label_pc(std::string &lab) const;
-  /// get the list of instructions (needed only in LLVMCodeGen)
-  instructionList get_instructions() const;
-
-  // print subroutine (params, vars, and instructions)
-  std::string dump() const;
+  size_t get_label_pc(const operand &lab) const;
+  /// get source position of the instruction at given program counter
+  sourcePos get_source_position(size_t pc) const;
+  /// get the list of instructions (for LLVMCodeGen and the analyses)
+  const instructionList &get_instructions() const;
+  /// get the spellings of the operands of the instructions (the
+  /// names of the params and the local vars are interned in them)
+  spellings &get_spellings();
+  const spellings &get_spellings() const;
+
+  // print subroutine (params, vars, and instructions). With sourceComments
+  // a ";;; line:column" comment precedes the code of each statement
+  std::string dump(bool sourceComments=false) const;
+  void dump(std::ostream &os, bool sourceComments=false) const;
 };
 
 
@@ -264,9 +419,8 @@ private:
   std::map<std::string, size_t> names;
   
 public:
-  /// constructor and destructor
+  /// constructor (no destructor is declared, so the code can be moved)
   code();
-  ~code();
 
   /// get most recently added subroutine (i.e. the one currently being processed)
   subroutine& get_last_subroutine();
@@ -274,13 +428,22 @@ public:
   const subroutine& get_subroutine(const std::string &name) const;
   /// add new subroutine
   void add_subroutine(const subroutine &s);
-  /// get the list of subroutines (needed only in LLVMCodeGen)
+  void add_subroutine(subroutine &&s);
+  /// get the list of subroutines (for LLVMCodeGen and the passes)
   const std::vector<subroutine> & get_subroutine_list() const;
-
-  // print code (all info for all subroutines)
-  std::string dump() const;
+  std::vector<subroutine> & get_subroutine_list();
+  /// remove a subroutine
+  void remove_subroutine(const std::string &name);
+
+  // print code (all info for all subroutines). The stream version
+  // writes each subroutine as it goes, without building the whole text
+  std::string dump(bool sourceComments=false) const;
+  void dump(std::ostream &os, bool sourceComments=false) const;
   /// print the code in LLVM IR
-  std::string dumpLLVM(const TypesMgr & Types, const SymTable &Symbols) const;
+  std::string dumpLLVM(const TypesMgr & Types, const SymTable &Symbols,
+                       bool sourceComments=false) const;
+  void dumpLLVM(const TypesMgr & Types, const SymTable &Symbols, std::ostream &os,
+                bool sourceComments=false) const;
   
   // Error codes for "HALT" instruction
   static const std::string INDEX_OUT_OF_RANGE;
@@ -290,28 +453,32 @@ public:
 
 
 ////////////////////////////////////////////////////////////////////
-/// Class counters manages temporal and labels counters
+/// Class counters manages temporal and labels counters.
+/// The counters are per object (each code generator owns its own),
+/// so that several programs can be translated at the same time.
 
 class counters {
 private:
-  static int countIF;
-  static int countWHILE;
-  static int countTEMP;
+  int countIF;
+  int countWHILE;
+  int countTEMP;
 
 public:
-  // return id for new label or temp (id is a number, but returned as string
-  // to ease concatenation with other literals (e.g. "labelIF" + "4" -> "LabelIF4")
-  static std::string newLabelIF();
-  static std::string newLabelWHILE();
-  static std::string newTEMP();
+  // constructor (all the counters start at zero)
+  counters();
+
+  // return id for new label (see operand::label) or new temp
+  unsigned int newLabelIF();
+  unsigned int newLabelWHILE();
+  operand newTEMP();
   
   // reset individual counters 
-  static void resetLabelIF();
-  static void resetLabelWHILE();
-  static void resetTEMP();
+  void resetLabelIF();
+  void resetLabelWHILE();
+  void resetTEMP();
   
   // reset label counters (IF and WHILE)
-  static void resetLabels();
+  void resetLabels();
   // reset all counters (IF, WHILE, and TEMP)
-  static void reset();
+  void reset();
 };
@@ -0,0 +1,377 @@
+/////////////////////////////////////////////////////////////////
+//
+//    TVM - t-Code Virtual Machine
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.320 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+
+#include <map>
+#include <utility>
+#include "passes.h"
+#include "flowgraph.h"
+#include "dataflow.h"
+
+using namespace std;
+
+
+namespace {
+
+  /// slots that hold a plain value: not the local arrays, nor the
+  /// array parameters (their slot holds the address of the array)
+  vector<bool> scalar_slots(const subroutine &sub, const slots &sl) {
+    vector<bool> scalar(sl.size(), true);
+    for (slots::slotId s = 0; s < sl.size(); ++s)
+      if (sl.is_array(s)) scalar[s] = false;
+    const string suffix = " array";
+    for (const var &p : sub.params) {
+      if (p.type.size() < suffix.size() or
+          p.type.compare(p.type.size() - suffix.size(), suffix.size(), suffix) != 0)
+        continue;
+      slots::slotId s = sl.slot_of(sub.get_spellings().find_name(p.name));
+      if (s != slots::NO_SLOT) scalar[s] = false;
+    }
+    return scalar;
+  }
+
+  /// true if inst is a copy between two different scalar slots (a = b)
+  bool is_copy(const instruction &inst, const slots &sl, const vector<bool> &scalar) {
+    if (inst.oper != instruction::_LOAD or inst.arg1 == inst.arg2) return false;
+    slots::slotId dst = sl.slot_of(inst.arg1), src = sl.slot_of(inst.arg2);
+    return dst != slots::NO_SLOT and src != slots::NO_SLOT and scalar[dst] and scalar[src];
+  }
+
+
+  ////////////////////////////////////////////////////////////////////
+  /// Available copies (forward, intersection, one bit per pair of
+  /// slots copied): a copy a = b is available at a point if every
+  /// path to it executes the copy and writes neither a nor b
+  /// afterwards, so a can be read from b instead.
+
+  class available_copies : public dataflow {
+  public:
+    available_copies(const flowgraph &graph, const slots &sl, const subroutine &sub,
+                     const vector<bool> &scalar);
+
+    /// slot that holds the same value as s given the available
+    /// copies (s itself if there is none)
+    slots::slotId source_of(slots::slotId s, const bitvector &avail) const;
+
+    /// update avail (the copies available before the instruction at
+    /// pc) to the ones available after it
+    void step(size_t pc, bitvector &avail) const;
+
+  private:
+    const instructionList &insts;
+    const slots &sl;
+    /// copy of each instruction (uint32_t(-1) if none), and the
+    /// source of each copy
+    vector<uint32_t> copyAt;
+    vector<slots::slotId> sources;
+    /// copies that write each slot, and the ones that read or write it
+    vector<vector<uint32_t>> slotDsts, slotCopies;
+  };
+
+  available_copies::available_copies(const flowgraph &g, const slots &slts,
+                                     const subroutine &sub, const vector<bool> &scalar)
+    : dataflow(g, 0, FORWARD, INTERSECTION), insts(sub.get_instructions()), sl(slts) {
+    // number the different copies
+    map<pair<slots::slotId, slots::slotId>, uint32_t> numbers;
+    copyAt.assign(insts.size(), uint32_t(-1));
+    slotDsts.resize(sl.size());
+    slotCopies.resize(sl.size());
+    for (size_t pc = 0; pc < insts.size(); ++pc) {
+      if (not is_copy(insts[pc], sl, scalar)) continue;
+      slots::slotId dst = sl.slot_of(insts[pc].arg1), src = sl.slot_of(insts[pc].arg2);
+      auto it = numbers.emplace(make_pair(dst, src), uint32_t(sources.size())).first;
+      if (it->second == sources.size()) {
+        sources.push_back(src);
+        slotDsts[dst].push_back(it->second);
+        slotCopies[dst].push_back(it->second);
+        slotCopies[src].push_back(it->second);
+      }
+      copyAt[pc] = it->second;
+    }
+
+    size_t numCopies = sources.size();
+    gens.assign(g.num_blocks(), bitvector(numCopies));
+    kills.assign(g.num_blocks(), bitvector(numCopies));
+    ins.assign(g.num_blocks(), bitvector(numCopies));
+    outs.assign(g.num_blocks(), bitvector(numCopies));
+    boundary = bitvector(numCopies);
+    for (flowgraph::blockId b = 0; b < g.num_blocks(); ++b) {
+      const flowgraph::block &blk = g.get_block(b);
+      for (size_t pc = blk.begin; pc < blk.end; ++pc) {
+        operand def = slots::get_def(insts[pc]);
+        if (not def.empty())
+          for (uint32_t c : slotCopies[sl.slot_of(def)]) {
+            gens[b].reset(c);
+            kills[b].set(c);
+          }
+        if (copyAt[pc] != uint32_t(-1)) gens[b].set(copyAt[pc]);
+      }
+    }
+    solve();
+  }
+
+  slots::slotId available_copies::source_of(slots::slotId s, const bitvector &avail) const {
+    // at most one copy into s is available (a copy kills the others)
+    for (uint32_t c : slotDsts[s])
+      if (avail.test(c)) return sources[c];
+    return s;
+  }
+
+  void available_copies::step(size_t pc, bitvector &avail) const {
+    operand def = slots::get_def(insts[pc]);
+    if (not def.empty())
+      for (uint32_t c : slotCopies[sl.slot_of(def)]) avail.reset(c);
+    if (copyAt[pc] != uint32_t(-1)) avail.set(copyAt[pc]);
+  }
+
+
+  /// the arguments of an instruction that are read as a plain value,
+  /// so a copy can be propagated into them (1 to 3, stored in args).
+  /// The addresses (the arrays of a1 = a2[a3] and a1[a2] = a3, the
+  /// pointers of *a1 = a2 and a1 = *a2, the array of a1 = &a2) are not
+  unsigned value_arguments(const instruction &inst, unsigned args[3]) {
+    switch (inst.oper) {
+    case instruction::_FJUMP: case instruction::_PUSH:
+    case instruction::_WRITEI: case instruction::_WRITEF: case instruction::_WRITEC:
+      args[0] = 1;
+      return 1;
+    case instruction::_LOAD: case instruction::_NEG: case instruction::_NOT:
+    case instruction::_FLOAT: case instruction::_FNEG:
+      args[0] = 2;
+      return 1;
+    case instruction::_ADD:  case instruction::_SUB:  case instruction::_MUL:
+    case instruction::_DIV:  case instruction::_EQ:   case instruction::_LT:
+    case instruction::_LE:   case instruction::_AND:  case instruction::_OR:
+    case instruction::_FADD: case instruction::_FSUB: case instruction::_FMUL:
+    case instruction::_FDIV: case instruction::_FEQ:  case instruction::_FLT:
+    case instruction::_FLE:
+    case instruction::_XLOAD:   // a1[a2] = a3
+      args[0] = 2; args[1] = 3;
+      return 2;
+    case instruction::_LOADX:   // a1 = a2[a3]
+      args[0] = 3;
+      return 1;
+    default:
+      return 0;
+    }
+  }
+
+  operand &argument(instruction &inst, unsigned k) {
+    return k == 1 ? inst.arg1 : (k == 2 ? inst.arg2 : inst.arg3);
+  }
+
+  /// true if the result of inst can be written directly into a
+  /// variable instead of a temporal. The loads of literals are not,
+  /// since the LLVM emitter types them by the temporal they load
+  bool can_retarget(const instruction &inst) {
+    switch (inst.oper) {
+    case instruction::_ADD:  case instruction::_SUB:  case instruction::_MUL:
+    case instruction::_DIV:  case instruction::_EQ:   case instruction::_LT:
+    case instruction::_LE:   case instruction::_NEG:  case instruction::_NOT:
+    case instruction::_AND:  case instruction::_OR:   case instruction::_FLOAT:
+    case instruction::_FADD: case instruction::_FSUB: case instruction::_FMUL:
+    case instruction::_FDIV: case instruction::_FEQ:  case instruction::_FLT:
+    case instruction::_FLE:  case instruction::_FNEG:
+    case instruction::_LOADX:
+      return true;
+    case instruction::_LOAD:
+      return inst.arg2.get_kind() == operand::TEMP or inst.arg2.get_kind() == operand::NAME;
+    default:
+      return false;
+    }
+  }
+
+  /// propagate the available copies into the uses. Returns true if
+  /// some argument changed
+  bool propagate(subroutine &sub, const flowgraph &graph, const slots &sl,
+                 const vector<bool> &scalar) {
+    available_copies copies(graph, sl, sub, scalar);
+    const instructionList &insts = sub.get_instructions();
+    bool changed = false;
+    unsigned args[3];
+    for (flowgraph::blockId b = 0; b < graph.num_blocks(); ++b) {
+      const flowgraph::block &blk = graph.get_block(b);
+      bitvector avail = copies.in(b);
+      for (size_t pc = blk.begin; pc < blk.end; ++pc) {
+        instruction inst = insts[pc];
+        bool rewritten = false;
+        unsigned n = value_arguments(inst, args);
+        for (unsigned i = 0; i < n; ++i) {
+          operand &arg = argument(inst, args[i]);
+          slots::slotId s = sl.slot_of(arg);
+          if (s == slots::NO_SLOT) continue;
+          // follow the chains of copies (a = b, c = a), all of them
+          // hold here. Each step leaves a slot written by a copy, so
+          // there are at most as many steps as slots
+          slots::slotId src = s;
+          for (size_t steps = 0; steps < sl.size(); ++steps) {
+            slots::slotId next = copies.source_of(src, avail);
+            if (next == src) break;
+            src = next;
+          }
+          if (src == s) continue;
+          arg = sl.operand_of(src);
+          rewritten = true;
+        }
+        copies.step(pc, avail);
+        if (rewritten) {
+          sub.set_instruction_at(pc, inst);
+          changed = true;
+        }
+      }
+    }
+    return changed;
+  }
+
+  /// write the result of t = <expr> directly into v when it is
+  /// followed by a copy v = t and t is not read anywhere else (the
+  /// code generator computes the right side of the assignments into
+  /// temporals). Removes the copies, and the copies of a slot into
+  /// itself. Returns true if something changed
+  bool coalesce(subroutine &sub, const slots &sl, const vector<bool> &scalar) {
+    const instructionList &insts = sub.get_instructions();
+    vector<uint32_t> reads(sl.size(), 0);
+    operand uses[3];
+    for (const instruction &inst : insts) {
+      unsigned n = slots::get_uses(inst, uses);
+      for (unsigned i = 0; i < n; ++i) ++reads[sl.slot_of(uses[i])];
+    }
+
+    vector<bool> removed(insts.size(), false);
+    bool changed = false;
+    for (size_t pc = 0; pc < insts.size(); ++pc) {
+      const instruction &inst = insts[pc];
+      if (inst.oper == instruction::_LOAD and inst.arg1 == inst.arg2) {
+        removed[pc] = true;
+        changed = true;
+        continue;
+      }
+      if (pc + 1 == insts.size() or not can_retarget(inst) or
+          inst.arg1.get_kind() != operand::TEMP)
+        continue;
+      const instruction &next = insts[pc + 1];
+      if (not is_copy(next, sl, scalar) or not (next.arg2 == inst.arg1) or
+          reads[sl.slot_of(inst.arg1)] != 1)
+        continue;
+      instruction retargeted = inst;
+      retargeted.arg1 = next.arg1;
+      sub.set_instruction_at(pc, retargeted);
+      removed[pc + 1] = true;
+      changed = true;
+      ++pc;
+    }
+    if (changed) sub.remove_instructions(removed);
+    return changed;
+  }
+
+
+  /// true if inst only writes its result: it can be removed when
+  /// the result is not read. Integer divisions may trap, and the
+  /// other loads, pops and reads have side effects
+  bool is_pure(const instruction &inst) {
+    switch (inst.oper) {
+    case instruction::_ADD:  case instruction::_SUB:  case instruction::_MUL:
+    case instruction::_EQ:   case instruction::_LT:   case instruction::_LE:
+    case instruction::_NEG:  case instruction::_NOT:  case instruction::_AND:
+    case instruction::_OR:   case instruction::_FLOAT:
+    case instruction::_FADD: case instruction::_FSUB: case instruction::_FMUL:
+    case instruction::_FDIV: case instruction::_FEQ:  case instruction::_FLT:
+    case instruction::_FLE:  case instruction::_FNEG:
+    case instruction::_LOAD: case instruction::_ILOAD: case instruction::_CHLOAD:
+    case instruction::_FLOAD: case instruction::_ALOAD:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'copy_propagation'
+
+string copy_propagation::get_name() const { return "copy-prop"; }
+
+bool copy_propagation::run(subroutine &sub) {
+  // first the values are computed into the variables they are
+  // copied to, so the uses read the variables. The propagation may
+  // leave copies of a slot into itself, removed at the end
+  bool changed = false;
+  {
+    slots sl(sub);
+    changed = coalesce(sub, sl, scalar_slots(sub, sl));
+  }
+  {
+    flowgraph graph(sub);
+    slots sl(sub);
+    if (propagate(sub, graph, sl, scalar_slots(sub, sl))) changed = true;
+  }
+  slots sl(sub);
+  if (coalesce(sub, sl, scalar_slots(sub, sl))) changed = true;
+  return changed;
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'dead_temporaries'
+
+string dead_temporaries::get_name() const { return "dead-temps"; }
+
+bool dead_temporaries::run(subroutine &sub) {
+  bool changed = false;
+  // removing an instruction may leave its operands dead, in other
+  // blocks too: repeat until nothing is removed
+  for (bool removing = true; removing; ) {
+    const instructionList &insts = sub.get_instructions();
+    flowgraph graph(sub);
+    slots sl(sub);
+    liveness live(graph, sl, sub);
+    vector<bool> removed(insts.size(), false);
+    removing = false;
+    for (flowgraph::blockId b = 0; b < graph.num_blocks(); ++b) {
+      const flowgraph::block &blk = graph.get_block(b);
+      bitvector alive = live.out(b);
+      for (size_t pc = blk.end; pc-- > blk.begin; ) {
+        const instruction &inst = insts[pc];
+        if (inst.arg1.get_kind() == operand::TEMP and is_pure(inst) and
+            not alive.test(sl.slot_of(inst.arg1))) {
+          removed[pc] = true;
+          removing = true;
+          continue;
+        }
+        liveness::step(inst, sl, alive);
+      }
+    }
+    if (removing) {
+      sub.remove_instructions(removed);
+      changed = true;
+    }
+  }
+  return changed;
+}
@@ -0,0 +1,416 @@
+/////////////////////////////////////////////////////////////////
+//
+//    TVM - t-Code Virtual Machine
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.320 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include "dataflow.h"
+
+using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'bitvector'
+
+/// constructor
+bitvector::bitvector(size_t n) : nbits(n), words((n + 63) / 64, 0) {}
+
+size_t bitvector::size() const { return nbits; }
+
+bool bitvector::test(size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+void bitvector::set(size_t i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+void bitvector::reset(size_t i) { words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+
+void bitvector::set_all() {
+  fill(words.begin(), words.end(), ~uint64_t(0));
+  trim();
+}
+void bitvector::reset_all() { fill(words.begin(), words.end(), 0); }
+
+/// this = this | o
+bool bitvector::union_with(const bitvector &o) {
+  uint64_t changed = 0;
+  for (size_t w = 0; w < words.size(); ++w) {
+    uint64_t v = words[w] | o.words[w];
+    changed |= v ^ words[w];
+    words[w] = v;
+  }
+  return changed != 0;
+}
+
+/// this = this & o
+bool bitvector::intersect_with(const bitvector &o) {
+  uint64_t changed = 0;
+  for (size_t w = 0; w < words.size(); ++w) {
+    uint64_t v = words[w] & o.words[w];
+    changed |= v ^ words[w];
+    words[w] = v;
+  }
+  return changed != 0;
+}
+
+/// this = this & ~o
+void bitvector::subtract(const bitvector &o) {
+  for (size_t w = 0; w < words.size(); ++w) words[w] &= ~o.words[w];
+}
+
+/// this = gen | (in & ~kill)
+bool bitvector::transfer(const bitvector &gen, const bitvector &in, const bitvector &kill) {
+  uint64_t changed = 0;
+  for (size_t w = 0; w < words.size(); ++w) {
+    uint64_t v = gen.words[w] | (in.words[w] & ~kill.words[w]);
+    changed |= v ^ words[w];
+    words[w] = v;
+  }
+  return changed != 0;
+}
+
+bool bitvector::operator==(const bitvector &o) const { return nbits == o.nbits and words == o.words; }
+bool bitvector::operator!=(const bitvector &o) const { return not (*this == o); }
+
+/// first set bit from i on
+size_t bitvector::next(size_t i) const {
+  if (i >= nbits) return nbits;
+  size_t w = i / 64;
+  uint64_t bits = words[w] & (~uint64_t(0) << (i % 64));
+  while (bits == 0) {
+    if (++w == words.size()) return nbits;
+    bits = words[w];
+  }
+  return w * 64 + __builtin_ctzll(bits);
+}
+
+/// clear the bits past nbits
+void bitvector::trim() {
+  if (nbits % 64 != 0) words.back() &= (uint64_t(1) << (nbits % 64)) - 1;
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'slots'
+
+/// slot not valid
+const slots::slotId slots::NO_SLOT;
+
+/// constructor: the params first, then the local vars, and then the
+/// operands of the instructions in order of appearance
+slots::slots(const subroutine &sub) {
+  const spellings &words = sub.get_spellings();
+  for (const var &p : sub.params) params[add(words.find_name(p.name))] = true;
+  for (const var &v : sub.vars)
+    if (v.type.compare(0, 5, "array") == 0) arrays[add(words.find_name(v.name))] = true;
+    else add(words.find_name(v.name));
+
+  operand uses[3];
+  for (const instruction &inst : sub.get_instructions()) {
+    unsigned n = get_uses(inst, uses);
+    for (unsigned i = 0; i < n; ++i) add(uses[i]);
+    operand def = get_def(inst);
+    if (not def.empty()) add(def);
+  }
+}
+
+/// slot of an operand, adding it if it is new
+slots::slotId slots::add(const operand &o) {
+  slotId s = slot_of(o);
+  if (s != NO_SLOT) return s;
+  s = operands.size();
+  if (o.get_kind() == operand::TEMP) {
+    if (o.get_value() >= tempSlots.size()) tempSlots.resize(o.get_value() + 1, NO_SLOT);
+    tempSlots[o.get_value()] = s;
+  }
+  else
+    nameSlots.emplace(o.get_value(), s);
+  operands.push_back(o);
+  params.push_back(false);
+  arrays.push_back(false);
+  return s;
+}
+
+size_t slots::size() const { return operands.size(); }
+
+/// slot of an operand
+slots::slotId slots::slot_of(const operand &o) const {
+  if (o.get_kind() == operand::TEMP)
+    return o.get_value() < tempSlots.size() ? tempSlots[o.get_value()] : NO_SLOT;
+  if (o.get_kind() != operand::NAME) return NO_SLOT;
+  auto it = nameSlots.find(o.get_value());
+  return it == nameSlots.end() ? NO_SLOT : it->second;
+}
+
+const operand &slots::operand_of(slotId s) const { return operands[s]; }
+bool slots::is_param(slotId s) const { return params[s]; }
+bool slots::is_array(slotId s) const { return arrays[s]; }
+
+/// operand written by an instruction
+operand slots::get_def(const instruction &inst) {
+  switch (inst.oper) {
+  case instruction::_ADD:  case instruction::_SUB:  case instruction::_MUL:
+  case instruction::_DIV:  case instruction::_EQ:   case instruction::_LT:
+  case instruction::_LE:   case instruction::_NEG:  case instruction::_NOT:
+  case instruction::_AND:  case instruction::_OR:   case instruction::_FLOAT:
+  case instruction::_FADD: case instruction::_FSUB: case instruction::_FMUL:
+  case instruction::_FDIV: case instruction::_FEQ:  case instruction::_FLT:
+  case instruction::_FLE:  case instruction::_FNEG:
+  case instruction::_LOAD: case instruction::_ILOAD: case instruction::_CHLOAD:
+  case instruction::_FLOAD: case instruction::_LOADX: case instruction::_ALOAD:
+  case instruction::_LOADC: case instruction::_POP:
+  case instruction::_READI: case instruction::_READF: case instruction::_READC:
+    if (inst.arg1.get_kind() == operand::TEMP or inst.arg1.get_kind() == operand::NAME)
+      return inst.arg1;
+    return operand();
+  default:
+    return operand();
+  }
+}
+
+/// operands read by an instruction
+unsigned slots::get_uses(const instruction &inst, operand uses[3]) {
+  unsigned n = 0;
+  auto use = [&](const operand &o) {
+    if (o.get_kind() == operand::TEMP or o.get_kind() == operand::NAME) uses[n++] = o;
+  };
+  switch (inst.oper) {
+  case instruction::_FJUMP: case instruction::_PUSH:
+  case instruction::_WRITEI: case instruction::_WRITEF: case instruction::_WRITEC:
+    use(inst.arg1);
+    break;
+  case instruction::_XLOAD:   // a1[a2] = a3
+    use(inst.arg1); use(inst.arg2); use(inst.arg3);
+    break;
+  case instruction::_CLOAD:   // *a1 = a2
+    use(inst.arg1); use(inst.arg2);
+    break;
+  case instruction::_LABEL: case instruction::_UJUMP: case instruction::_HALT:
+  case instruction::_POP:   case instruction::_CALL:  case instruction::_RETURN:
+  case instruction::_READI: case instruction::_READF: case instruction::_READC:
+  case instruction::_WRITES: case instruction::_WRITELN: case instruction::_NOOP:
+  case instruction::_INVALID:
+    break;
+  default:                    // a1 = a2 op a3, a1 = op a2, loads
+    use(inst.arg2); use(inst.arg3);
+    break;
+  }
+  return n;
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'dataflow'
+
+/// constructor
+dataflow::dataflow(const flowgraph &g, size_t nbits, Direction d, Meet m)
+  : graph(g), dir(d), meet(m),
+    gens(g.num_blocks(), bitvector(nbits)), kills(g.num_blocks(), bitvector(nbits)),
+    ins(g.num_blocks(), bitvector(nbits)), outs(g.num_blocks(), bitvector(nbits)),
+    boundary(nbits), visits(0) {}
+
+const flowgraph &dataflow::get_graph() const { return graph; }
+const bitvector &dataflow::in(flowgraph::blockId b) const { return ins[b]; }
+const bitvector &dataflow::out(flowgraph::blockId b) const { return outs[b]; }
+size_t dataflow::num_visits() const { return visits; }
+
+/// iterate to the fixed point. The blocks are kept in reverse
+/// postorder for forward problems (postorder for backward ones), and
+/// the pending blocks are visited in sweeps over that order, so a
+/// change reaches all the blocks after it in the same sweep. Only the
+/// back edges need another sweep
+void dataflow::solve() {
+  typedef flowgraph::blockId blockId;
+  size_t n = graph.num_blocks();
+  bool forward = dir == FORWARD;
+
+  for (blockId b = 0; b < n; ++b) {
+    if (meet == INTERSECTION) {
+      ins[b].set_all();
+      outs[b].set_all();
+    }
+    else {
+      ins[b].reset_all();
+      outs[b].reset_all();
+    }
+  }
+
+  // order of the blocks (the unreachable ones go at the end), and the
+  // position of each block in it
+  vector<blockId> order;
+  order.reserve(n);
+  vector<uint32_t> position(n, uint32_t(-1));
+  const vector<blockId> &rpo = graph.reverse_postorder();
+  auto add = [&](blockId b) {
+    if (position[b] != uint32_t(-1)) return;
+    position[b] = order.size();
+    order.push_back(b);
+  };
+  if (forward) for (auto it = rpo.begin(); it != rpo.end(); ++it) add(*it);
+  else for (auto it = rpo.rbegin(); it != rpo.rend(); ++it) add(*it);
+  for (blockId b = 0; b < n; ++b) add(b);
+
+  vector<bool> pending(n, true);
+  size_t numPending = n;
+  blockId boundaryBlock = forward ? graph.entry_block() : graph.exit_block();
+  while (numPending > 0) {
+    for (size_t i = 0; i < n; ++i) {
+      if (not pending[i]) continue;
+      pending[i] = false;
+      --numPending;
+      ++visits;
+
+      blockId b = order[i];
+      const flowgraph::block &blk = graph.get_block(b);
+      const vector<blockId> &from = forward ? blk.preds : blk.succs;
+      bitvector &input = forward ? ins[b] : outs[b];
+      bitvector &result = forward ? outs[b] : ins[b];
+      const vector<bitvector> &others = forward ? outs : ins;
+
+      // meet of the neighbours (and of the boundary value)
+      if (b == boundaryBlock) input = boundary;
+      else if (meet == INTERSECTION) input.set_all();
+      else input.reset_all();
+      for (blockId p : from) {
+        if (meet == INTERSECTION) input.intersect_with(others[p]);
+        else input.union_with(others[p]);
+      }
+
+      if (not result.transfer(gens[b], input, kills[b])) continue;
+      for (blockId s : forward ? blk.succs : blk.preds)
+        if (not pending[position[s]]) {
+          pending[position[s]] = true;
+          ++numPending;
+        }
+    }
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'liveness'
+
+/// constructor
+liveness::liveness(const flowgraph &g, const slots &sl, const subroutine &sub)
+  : dataflow(g, sl.size(), BACKWARD, UNION) {
+  const instructionList &code = sub.get_instructions();
+  operand uses[3];
+  for (flowgraph::blockId b = 0; b < g.num_blocks(); ++b) {
+    const flowgraph::block &blk = g.get_block(b);
+    // walk backwards as in step: gen ends with the slots read in the
+    // block before being written, and kill with the slots written
+    for (size_t pc = blk.end; pc-- > blk.begin; ) {
+      const instruction &inst = code[pc];
+      operand def = slots::get_def(inst);
+      if (not def.empty()) {
+        slots::slotId s = sl.slot_of(def);
+        kills[b].set(s);
+        gens[b].reset(s);
+      }
+      unsigned n = slots::get_uses(inst, uses);
+      for (unsigned i = 0; i < n; ++i) gens[b].set(sl.slot_of(uses[i]));
+    }
+  }
+  for (slots::slotId s = 0; s < sl.size(); ++s)
+    if (sl.is_param(s)) boundary.set(s);
+  solve();
+}
+
+/// slots live before inst
+void liveness::step(const instruction &inst, const slots &sl, bitvector &live) {
+  operand def = slots::get_def(inst);
+  if (not def.empty()) live.reset(sl.slot_of(def));
+  operand uses[3];
+  unsigned n = slots::get_uses(inst, uses);
+  for (unsigned i = 0; i < n; ++i) live.set(sl.slot_of(uses[i]));
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'reaching_definitions'
+
+/// definition not valid
+const size_t reaching_definitions::NO_DEF;
+
+/// number of instructions that define a slot
+static size_t count_defs(const subroutine &sub) {
+  size_t n = 0;
+  for (const instruction &inst : sub.get_instructions())
+    if (not slots::get_def(inst).empty()) ++n;
+  return n;
+}
+
+/// constructor
+reaching_definitions::reaching_definitions(const flowgraph &g, const slots &sl,
+                                           const subroutine &sub)
+  : dataflow(g, sl.size() + count_defs(sub), FORWARD, UNION) {
+  const instructionList &code = sub.get_instructions();
+  defAt.assign(code.size(), uint32_t(-1));
+  slotDefs.resize(sl.size());
+  // the entry definitions reach the start of the subroutine
+  for (slots::slotId s = 0; s < sl.size(); ++s) {
+    slotDefs[s].push_back(defPc.size());
+    boundary.set(defPc.size());
+    defPc.push_back(subroutine::NO_PC);
+    defSlot.push_back(s);
+  }
+  for (size_t pc = 0; pc < code.size(); ++pc) {
+    operand def = slots::get_def(code[pc]);
+    if (def.empty()) continue;
+    slots::slotId s = sl.slot_of(def);
+    defAt[pc] = defPc.size();
+    slotDefs[s].push_back(defPc.size());
+    defPc.push_back(pc);
+    defSlot.push_back(s);
+  }
+
+  // only the last definition of each slot in a block reaches its end,
+  // so the block is walked backwards, skipping the slots already seen
+  vector<flowgraph::blockId> seen(sl.size(), flowgraph::NO_BLOCK);
+  for (flowgraph::blockId b = 0; b < g.num_blocks(); ++b) {
+    const flowgraph::block &blk = g.get_block(b);
+    for (size_t pc = blk.end; pc-- > blk.begin; ) {
+      if (defAt[pc] == uint32_t(-1)) continue;
+      slots::slotId s = defSlot[defAt[pc]];
+      if (seen[s] == b) continue;
+      seen[s] = b;
+      for (uint32_t d : slotDefs[s]) kills[b].set(d);
+      gens[b].set(defAt[pc]);
+    }
+  }
+  solve();
+}
+
+size_t reaching_definitions::num_defs() const { return defPc.size(); }
+size_t reaching_definitions::def_pc(size_t d) const { return defPc[d]; }
+slots::slotId reaching_definitions::def_slot(size_t d) const { return defSlot[d]; }
+size_t reaching_definitions::def_at(size_t pc) const {
+  return defAt[pc] == uint32_t(-1) ? NO_DEF : defAt[pc];
+}
+const vector<uint32_t> &reaching_definitions::defs_of(slots::slotId s) const { return slotDefs[s]; }
+
+/// definitions that reach the instruction after pc
+void reaching_definitions::step(size_t pc, bitvector &reach) const {
+  if (defAt[pc] == uint32_t(-1)) return;
+  for (uint32_t d : slotDefs[defSlot[defAt[pc]]]) reach.reset(d);
+  reach.set(defAt[pc]);
+}
@@ -0,0 +1,224 @@
+/////////////////////////////////////////////////////////////////
+//
+//    TVM - t-Code Virtual Machine
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.320 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include "code.h"
+#include "flowgraph.h"
+
+
+////////////////////////////////////////////////////////////////////
+/// Class bitvector stores a fixed-size set of bits, packed in 64-bit
+/// words. The operations used by the dataflow solver work word by
+/// word in place and tell whether the set changed, so iterating to a
+/// fixed point does not allocate.
+
+class bitvector {
+public:
+  /// constructor (all the bits are cleared)
+  bitvector(std::size_t nbits=0);
+
+  /// number of bits
+  std::size_t size() const;
+  /// get/set/clear a bit
+  bool test(std::size_t i) const;
+  void set(std::size_t i);
+  void reset(std::size_t i);
+  /// set or clear all the bits
+  void set_all();
+  void reset_all();
+
+  /// this = this | o (or this & o), returning true if this changed
+  bool union_with(const bitvector &o);
+  bool intersect_with(const bitvector &o);
+  /// this = this & ~o
+  void subtract(const bitvector &o);
+  /// this = gen | (in & ~kill), returning true if this changed
+  bool transfer(const bitvector &gen, const bitvector &in, const bitvector &kill);
+
+  bool operator==(const bitvector &o) const;
+  bool operator!=(const bitvector &o) const;
+
+  /// position of the first set bit from i on (size() if none), to
+  /// iterate over the set bits
+  std::size_t next(std::size_t i) const;
+
+private:
+  std::size_t nbits;
+  std::vector<std::uint64_t> words;
+  /// clear the bits past nbits in the last word
+  void trim();
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Class slots gives a dense number (a slot) to each temporal and
+/// variable of a subroutine: its parameters, its local variables,
+/// and the temporals and names read or written by its instructions.
+/// The analyses index their bit vectors by slot. It also knows which
+/// operands each instruction reads and writes.
+
+class slots {
+public:
+  typedef std::uint32_t slotId;
+  /// slot of an operand that is not a temporal or a variable
+  static const slotId NO_SLOT = slotId(-1);
+
+  /// constructor: number the slots of the subroutine
+  slots(const subroutine &sub);
+
+  /// number of slots
+  std::size_t size() const;
+  /// slot of an operand (NO_SLOT if it is not a temporal or a name)
+  slotId slot_of(const operand &o) const;
+  /// operand of a slot
+  const operand &operand_of(slotId s) const;
+  /// true if the slot is a parameter (including _result)
+  bool is_param(slotId s) const;
+  /// true if the slot is a local array (its elements live in memory,
+  /// so its slot is never written as a whole)
+  bool is_array(slotId s) const;
+
+  /// operand written by an instruction (an empty operand if none).
+  /// Stores into array elements (a1[a2] = a3, *a1 = a2) write memory,
+  /// not a slot
+  static operand get_def(const instruction &inst);
+  /// operands read by an instruction, stored in uses. Returns how
+  /// many there are (at most 3). Only temporals and names are returned
+  static unsigned get_uses(const instruction &inst, operand uses[3]);
+
+private:
+  /// operand of each slot, and whether it is a param or an array
+  std::vector<operand> operands;
+  std::vector<bool> params, arrays;
+  /// slot of each temporal (by number) and of each name (by position
+  /// in the pool)
+  std::vector<slotId> tempSlots;
+  std::unordered_map<std::uint32_t, slotId> nameSlots;
+
+  /// slot of an operand, adding it if it is new
+  slotId add(const operand &o);
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Class dataflow is an iterative worklist solver for bit vector
+/// dataflow problems over a flowgraph. Each block has a gen and a
+/// kill set; the analyses derived from this class fill them and call
+/// solve(). The sets in(b) and out(b) are at the beginning and at the
+/// end of the block (in program order, whatever the direction). For
+/// a forward problem
+///     in(b) = meet of out(p) for each predecessor p
+///     out(b) = gen(b) | (in(b) & ~kill(b))
+/// and a backward problem swaps in and out and follows successors.
+/// The meet is the union or the intersection. The boundary value is
+/// met at the entry (forward) or at the exit (backward).
+
+class dataflow {
+public:
+  typedef enum : unsigned char {FORWARD, BACKWARD} Direction;
+  typedef enum : unsigned char {UNION, INTERSECTION} Meet;
+
+  /// constructor: nbits per set. The gen, kill and boundary sets start
+  /// empty
+  dataflow(const flowgraph &graph, std::size_t nbits, Direction dir, Meet meet);
+
+  /// the flowgraph
+  const flowgraph &get_graph() const;
+  /// the solution at the beginning and at the end of a block
+  const bitvector &in(flowgraph::blockId b) const;
+  const bitvector &out(flowgraph::blockId b) const;
+  /// how many blocks were evaluated until the fixed point
+  std::size_t num_visits() const;
+
+protected:
+  const flowgraph &graph;
+  Direction dir;
+  Meet meet;
+  std::vector<bitvector> gens, kills, ins, outs;
+  bitvector boundary;
+  std::size_t visits;
+
+  /// iterate to the fixed point
+  void solve();
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Liveness (backward, union, one bit per slot): a slot is live at a
+/// point if its value may be read before it is written again. The
+/// parameters are live at the exit (_result is read by the caller).
+
+class liveness : public dataflow {
+public:
+  liveness(const flowgraph &graph, const slots &sl, const subroutine &sub);
+
+  /// update live (the slots live after inst) to the slots live
+  /// before inst, to walk a block backwards from out(b)
+  static void step(const instruction &inst, const slots &sl, bitvector &live);
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Reaching definitions (forward, union, one bit per instruction
+/// that writes a slot): a definition reaches a point if there is a
+/// path from it where its slot is not written again. Each slot has
+/// also an entry definition (the first ones, numbered as the slots,
+/// with def_pc NO_PC) for the value it has when the subroutine starts
+/// (a parameter, or an uninitialized variable).
+
+class reaching_definitions : public dataflow {
+public:
+  reaching_definitions(const flowgraph &graph, const slots &sl, const subroutine &sub);
+
+  /// number of definitions, and the program counter and slot of each
+  /// one (the entry definitions are at subroutine::NO_PC)
+  std::size_t num_defs() const;
+  std::size_t def_pc(std::size_t d) const;
+  slots::slotId def_slot(std::size_t d) const;
+  /// definition made by the instruction at pc (NO_DEF if none)
+  std::size_t def_at(std::size_t pc) const;
+  /// definitions of a slot
+  const std::vector<std::uint32_t> &defs_of(slots::slotId s) const;
+
+  static const std::size_t NO_DEF = std::size_t(-1);
+
+  /// update reach (the definitions that reach inst) to the ones that
+  /// reach the next instruction
+  void step(std::size_t pc, bitvector &reach) const;
+
+private:
+  std::vector<std::size_t> defPc;
+  std::vector<slots::slotId> defSlot;
+  std::vector<std::uint32_t> defAt;
+  std::vector<std::vector<std::uint32_t>> slotDefs;
+};
@@ -0,0 +1,153 @@
+/////////////////////////////////////////////////////////////////
+//
+//    TVM - t-Code Virtual Machine
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.320 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include "flowgraph.h"
+
+using namespace std;
+
+
+/// block id not valid
+const flowgraph::blockId flowgraph::NO_BLOCK;
+
+/// constructor: build the graph
+flowgraph::flowgraph(const subroutine &sub)
+  : instructions(sub.get_instructions()) {
+  build_blocks(sub);
+
+  rpo = compute_rpo(entry_block());
+  reachable.assign(blocks.size(), false);
+  for (blockId b : rpo) reachable[b] = true;
+}
+
+/// split the instructions in blocks and add the edges
+void flowgraph::build_blocks(const subroutine &sub) {
+  size_t n = instructions.size();
+
+  // leaders: first instruction, labels and instructions after a jump
+  vector<bool> leader(n + 1, false);
+  leader[0] = true;
+  for (size_t pc = 0; pc < n; ++pc) {
+    switch (instructions[pc].oper) {
+    case instruction::_LABEL:
+      leader[pc] = true;
+      break;
+    case instruction::_UJUMP: case instruction::_FJUMP:
+    case instruction::_RETURN: case instruction::_HALT:
+      leader[pc + 1] = true;
+      break;
+    default:
+      break;
+    }
+  }
+
+  blockOf.assign(n, NO_BLOCK);
+  for (size_t pc = 0; pc < n; ++pc) {
+    if (leader[pc]) blocks.push_back(block{pc, pc, {}, {}});
+    blocks.back().end = pc + 1;
+    blockOf[pc] = blocks.size() - 1;
+  }
+  if (blocks.empty()) blocks.push_back(block{0, 0, {}, {}});
+  blocks.push_back(block{n, n, {}, {}});   // exit block
+
+  // edges
+  auto addEdge = [this](blockId from, blockId to) {
+    vector<blockId> &succs = blocks[from].succs;
+    if (find(succs.begin(), succs.end(), to) != succs.end()) return;
+    succs.push_back(to);
+    blocks[to].preds.push_back(from);
+  };
+  auto target = [&](const operand &label) -> blockId {
+    size_t pc = sub.get_label_pc(label);
+    return pc < n ? blockOf[pc] : exit_block();
+  };
+  for (blockId b = 0; b < exit_block(); ++b) {
+    block &blk = blocks[b];
+    if (blk.begin == blk.end) {          // empty subroutine
+      addEdge(b, exit_block());
+      continue;
+    }
+    const instruction &last = instructions[blk.end - 1];
+    switch (last.oper) {
+    case instruction::_UJUMP:
+      addEdge(b, target(last.arg1));
+      break;
+    case instruction::_FJUMP:
+      addEdge(b, target(last.arg2));
+      addEdge(b, b + 1);                 // fall through (maybe to the exit)
+      break;
+    case instruction::_RETURN: case instruction::_HALT:
+      addEdge(b, exit_block());
+      break;
+    default:
+      addEdge(b, b + 1);
+      break;
+    }
+  }
+}
+
+/// reverse postorder from b, following succs. The depth-first search
+/// uses an explicit stack
+vector<flowgraph::blockId> flowgraph::compute_rpo(blockId b) const {
+  vector<blockId> order;
+  vector<bool> visited(blocks.size(), false);
+  // pairs (block, next edge to follow)
+  vector<pair<blockId, size_t>> stack;
+  stack.push_back({b, 0});
+  visited[b] = true;
+  while (not stack.empty()) {
+    blockId cur = stack.back().first;
+    size_t &next = stack.back().second;
+    const vector<blockId> &edges = blocks[cur].succs;
+    if (next < edges.size()) {
+      blockId s = edges[next++];
+      if (not visited[s]) {
+        visited[s] = true;
+        stack.push_back({s, 0});
+      }
+    }
+    else {
+      order.push_back(cur);
+      stack.pop_back();
+    }
+  }
+  reverse(order.begin(), order.end());
+  return order;
+}
+
+/// accessors
+size_t flowgraph::num_blocks() const { return blocks.size(); }
+flowgraph::blockId flowgraph::entry_block() const { return 0; }
+flowgraph::blockId flowgraph::exit_block() const { return blocks.size() - 1; }
+const flowgraph::block &flowgraph::get_block(blockId b) const { return blocks[b]; }
+flowgraph::blockId flowgraph::block_of(size_t pc) const {
+  return pc < blockOf.size() ? blockOf[pc] : exit_block();
+}
+const vector<flowgraph::blockId> &flowgraph::reverse_postorder() const { return rpo; }
+bool flowgraph::is_reachable(blockId b) const { return reachable[b]; }
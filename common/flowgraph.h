@@ -0,0 +1,93 @@
+/////////////////////////////////////////////////////////////////
+//
+//    TVM - t-Code Virtual Machine
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.320 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "code.h"
+
+
+////////////////////////////////////////////////////////////////////
+/// Class flowgraph stores the control flow graph of a subroutine:
+/// its basic blocks and the edges between them. A block starts at the first instruction, at
+/// each label and after each jump, return or halt. Block 0 is the
+/// entry, and a virtual exit block (exit_block(), with no
+/// instructions) follows the blocks that return, halt or fall off the
+/// end of the subroutine. The graph refers to the instructions by
+/// their position, so it must be built again when they change.
+
+class flowgraph {
+public:
+  typedef std::uint32_t blockId;
+  /// id of a block that does not exist
+  static const blockId NO_BLOCK = blockId(-1);
+
+  /// a basic block: the instructions in [begin, end) of the subroutine
+  struct block {
+    std::size_t begin, end;
+    std::vector<blockId> succs;
+    std::vector<blockId> preds;
+  };
+
+  /// constructor: build the graph
+  flowgraph(const subroutine &sub);
+
+  /// number of blocks (including the exit block)
+  std::size_t num_blocks() const;
+  /// the entry block (0) and the virtual exit block (the last one)
+  blockId entry_block() const;
+  blockId exit_block() const;
+  /// get a block
+  const block &get_block(blockId b) const;
+  /// block that contains the instruction at given program counter
+  blockId block_of(std::size_t pc) const;
+
+  /// blocks reachable from the entry, in reverse postorder (an order
+  /// where each block comes before its successors, back edges aside)
+  const std::vector<blockId> &reverse_postorder() const;
+  /// true if b is reachable from the entry
+  bool is_reachable(blockId b) const;
+
+private:
+  /// instructions of the subroutine
+  const instructionList &instructions;
+  /// the blocks, and the block of each instruction
+  std::vector<block> blocks;
+  std::vector<blockId> blockOf;
+  /// reverse postorder of the blocks from the entry, and the blocks
+  /// that it reaches
+  std::vector<blockId> rpo;
+  std::vector<bool> reachable;
+
+  /// split the instructions in blocks and add the edges
+  void build_blocks(const subroutine &sub);
+  /// reverse postorder from b, following succs
+  std::vector<blockId> compute_rpo(blockId b) const;
+};
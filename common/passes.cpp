@@ -0,0 +1,210 @@
+/////////////////////////////////////////////////////////////////
+//
+//    TVM - t-Code Virtual Machine
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.320 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <set>
+#include "passes.h"
+#include "flowgraph.h"
+
+using namespace std;
+
+
+namespace {
+
+  /// names of a pipeline ("a,b,c"), with no empty names
+  vector<string> split_pipeline(const string &pipeline) {
+    vector<string> names;
+    size_t start = 0;
+    while (start <= pipeline.size()) {
+      size_t comma = pipeline.find(',', start);
+      if (comma == string::npos) comma = pipeline.size();
+      if (comma > start) names.push_back(pipeline.substr(start, comma - start));
+      start = comma + 1;
+    }
+    return names;
+  }
+
+  size_t count_instructions(const code &prog) {
+    size_t n = 0;
+    for (const subroutine &s : prog.get_subroutine_list()) n += s.get_instructions().size();
+    return n;
+  }
+
+}
+
+
+pass::~pass() {}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'unreachable_code'
+
+string unreachable_code::get_name() const { return "unreachable-code"; }
+
+bool unreachable_code::run(subroutine &sub) {
+  const instructionList &insts = sub.get_instructions();
+  flowgraph graph(sub);
+  vector<bool> removed(insts.size(), false);
+  bool changed = false;
+  for (flowgraph::blockId b = 0; b < graph.num_blocks(); ++b) {
+    if (graph.is_reachable(b)) continue;
+    const flowgraph::block &blk = graph.get_block(b);
+    for (size_t pc = blk.begin; pc < blk.end; ++pc) {
+      // keep the final return
+      if (pc + 1 == insts.size() and insts[pc].oper == instruction::_RETURN) continue;
+      removed[pc] = true;
+      changed = true;
+    }
+  }
+  if (changed) sub.remove_instructions(removed);
+  return changed;
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'dead_subroutines'
+
+string dead_subroutines::get_name() const { return "dead-subroutines"; }
+
+bool dead_subroutines::run(code &prog) {
+  const vector<subroutine> &subs = prog.get_subroutine_list();
+  // subroutines reachable from main through the calls
+  set<string> called;
+  vector<const subroutine *> pending;
+  for (const subroutine &s : subs)
+    if (s.get_name() == "main") {
+      called.insert("main");
+      pending.push_back(&s);
+    }
+  if (pending.empty()) return false;
+  while (not pending.empty()) {
+    const subroutine *s = pending.back();
+    pending.pop_back();
+    for (const instruction &inst : s->get_instructions()) {
+      if (inst.oper != instruction::_CALL) continue;
+      string name = s->get_spellings().str(inst.arg1);
+      if (not called.insert(name).second) continue;
+      for (const subroutine &t : subs)
+        if (t.get_name() == name) pending.push_back(&t);
+    }
+  }
+
+  vector<string> dead;
+  for (const subroutine &s : subs)
+    if (called.count(s.get_name()) == 0) dead.push_back(s.get_name());
+  for (const string &name : dead) prog.remove_subroutine(name);
+  return not dead.empty();
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'pass_manager'
+
+/// create a pass given its name
+unique_ptr<pass> pass_manager::create(const string &name) {
+  if (name == "unreachable-code") return unique_ptr<pass>(new unreachable_code());
+  if (name == "dead-subroutines") return unique_ptr<pass>(new dead_subroutines());
+  if (name == "sccp")             return unique_ptr<pass>(new sccp());
+  if (name == "copy-prop")        return unique_ptr<pass>(new copy_propagation());
+  if (name == "dead-temps")       return unique_ptr<pass>(new dead_temporaries());
+  return nullptr;
+}
+
+/// constructor
+pass_manager::pass_manager(const string &pipeline) {
+  for (const string &name : split_pipeline(pipeline)) {
+    unique_ptr<pass> p = create(name);
+    if (p == nullptr) continue;
+    stages.emplace_back();
+    stages.back().p = std::move(p);
+  }
+}
+
+/// true if all the names are known
+bool pass_manager::is_valid(const string &pipeline) {
+  for (const string &name : split_pipeline(pipeline))
+    if (create(name) == nullptr) return false;
+  return true;
+}
+
+/// pipeline of an optimization level
+string pass_manager::preset(unsigned int level) {
+  if (level == 0) return "";
+  if (level == 1) return "sccp,copy-prop,dead-temps";
+  return "sccp,copy-prop,dead-temps,dead-subroutines";
+}
+
+bool pass_manager::empty() const { return stages.empty(); }
+
+/// run a function pass over a subroutine
+void pass_manager::run_on(stage &st, function_pass &fp, subroutine &sub) {
+  st.before += sub.get_instructions().size();
+  auto start = chrono::steady_clock::now();
+  fp.run(sub);
+  st.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  st.after += sub.get_instructions().size();
+  ++st.runs;
+}
+
+/// run the pipeline over the program
+void pass_manager::run(code &prog) {
+  for (stage &st : stages) {
+    if (auto fp = dynamic_cast<function_pass *>(st.p.get())) {
+      for (subroutine &sub : prog.get_subroutine_list()) run_on(st, *fp, sub);
+    }
+    else if (auto mp = dynamic_cast<module_pass *>(st.p.get())) {
+      st.before += count_instructions(prog);
+      auto start = chrono::steady_clock::now();
+      mp->run(prog);
+      st.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+      st.after += count_instructions(prog);
+      ++st.runs;
+    }
+  }
+}
+
+/// run the function passes over a subroutine
+void pass_manager::run(subroutine &sub) {
+  for (stage &st : stages)
+    if (auto fp = dynamic_cast<function_pass *>(st.p.get())) run_on(st, *fp, sub);
+}
+
+/// print the statistics of each pass
+void pass_manager::dump_statistics(ostream &os) const {
+  os << "-- " << left << setw(20) << "pass" << right << setw(6) << "runs"
+     << setw(12) << "time (ms)" << "  instructions" << endl;
+  for (const stage &st : stages) {
+    long delta = long(st.after) - long(st.before);
+    os << "-- " << left << setw(20) << st.p->get_name() << right << setw(6) << st.runs
+       << setw(12) << fixed << setprecision(3) << st.seconds * 1000 << defaultfloat
+       << "  " << st.before << " -> " << st.after
+       << " (" << (delta > 0 ? "+" : "") << delta << ")" << endl;
+  }
+}
@@ -0,0 +1,181 @@
+/////////////////////////////////////////////////////////////////
+//
+//    TVM - t-Code Virtual Machine
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.320 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <iosfwd>
+#include "code.h"
+
+
+////////////////////////////////////////////////////////////////////
+/// Class pass is a transformation of the generated code, applied
+/// between the code generation and the emission of the t-code and
+/// the LLVM IR. A function pass transforms one subroutine at a time,
+/// and a module pass the whole program.
+
+class pass {
+public:
+  virtual ~pass();
+  /// name of the pass (as given to --passes)
+  virtual std::string get_name() const = 0;
+};
+
+class function_pass : public pass {
+public:
+  /// transform a subroutine. Returns true if it changed
+  virtual bool run(subroutine &sub) = 0;
+};
+
+class module_pass : public pass {
+public:
+  /// transform the program. Returns true if it changed
+  virtual bool run(code &prog) = 0;
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Function pass unreachable-code: removes the instructions that can
+/// not be reached from the start of the subroutine. The final return
+/// is kept, so the code never falls off the end.
+
+class unreachable_code : public function_pass {
+public:
+  std::string get_name() const override;
+  bool run(subroutine &sub) override;
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Module pass dead-subroutines: removes the subroutines that are
+/// not called from main (directly or through other subroutines).
+
+class dead_subroutines : public module_pass {
+public:
+  std::string get_name() const override;
+  bool run(code &prog) override;
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Function pass sccp: sparse conditional constant propagation. The
+/// values of the temporals and variables are propagated along the
+/// def-use chains (given by the reaching definitions, since t-code is
+/// not in SSA form), only through the code that can be executed
+/// given the conditions known so far. Then the instructions that
+/// compute a constant become loads of the constant, the conditional
+/// jumps with a known condition become unconditional jumps (or are
+/// removed), and the code that can no longer be reached is removed.
+/// Integer arithmetic wraps around at 32 bits and float arithmetic is
+/// done in single precision, as in the VM. Integer divisions that
+/// would trap, and float results that have no literal (infinities,
+/// NaNs and negative values) are not folded.
+
+class sccp : public function_pass {
+public:
+  std::string get_name() const override;
+  bool run(subroutine &sub) override;
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Function pass copy-prop: copy propagation. The uses of a slot
+/// copied from another one (a = b) read the source instead, where the
+/// copy is available (given by a dataflow analysis), so the copies
+/// the code generator makes through temporals are no longer read.
+/// Then a value computed into a temporal that is only copied into a
+/// variable (t = x + y; v = t) is computed into the variable. Arrays
+/// and array parameters are never propagated, and addresses (the
+/// array of an indexed access) are not replaced.
+
+class copy_propagation : public function_pass {
+public:
+  std::string get_name() const override;
+  bool run(subroutine &sub) override;
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Function pass dead-temps: removes the instructions that write a
+/// temporal that is not live afterwards, as long as they have no
+/// other effect (loads, arithmetic and comparisons, but not integer
+/// divisions, which may trap, nor loads from memory, pops or reads).
+
+class dead_temporaries : public function_pass {
+public:
+  std::string get_name() const override;
+  bool run(subroutine &sub) override;
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Class pass_manager runs a pipeline of passes, given by their names
+/// separated by commas (e.g. "unreachable-code,dead-subroutines").
+/// The function passes are applied to every subroutine before the
+/// next pass of the pipeline runs. For each pass it keeps the time
+/// spent and the number of instructions before and after it.
+
+class pass_manager {
+public:
+  /// constructor (the unknown names are ignored, see is_valid)
+  pass_manager(const std::string &pipeline);
+
+  /// true if all the names of the pipeline are known passes
+  static bool is_valid(const std::string &pipeline);
+  /// pipeline of an optimization level (-O0, -O1, -O2). -O0 has no
+  /// passes, so the code is emitted as generated
+  static std::string preset(unsigned int level);
+
+  /// true if there are no passes
+  bool empty() const;
+  /// run the pipeline over the program
+  void run(code &prog);
+  /// run the function passes of the pipeline over a subroutine (the
+  /// module passes are skipped)
+  void run(subroutine &sub);
+
+  /// print a line per pass with its runs, time and instruction counts
+  void dump_statistics(std::ostream &os) const;
+
+private:
+  struct stage {
+    std::unique_ptr<pass> p;
+    std::size_t runs = 0;
+    double seconds = 0;
+    std::size_t before = 0, after = 0;
+  };
+  std::vector<stage> stages;
+
+  /// create a pass given its name (null if unknown)
+  static std::unique_ptr<pass> create(const std::string &name);
+  /// run a function pass over a subroutine, updating its statistics
+  static void run_on(stage &st, function_pass &fp, subroutine &sub);
+};
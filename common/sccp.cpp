@@ -0,0 +1,468 @@
+/////////////////////////////////////////////////////////////////
+//
+//    TVM - t-Code Virtual Machine
+//
+//    Copyright (C) 2020-2030  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: Lluis Padro (padro@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.320 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <climits>
+#include "passes.h"
+#include "flowgraph.h"
+#include "dataflow.h"
+
+using namespace std;
+
+
+namespace {
+
+  /// a value of the lattice: unknown yet (TOP), a constant, or not a
+  /// constant (BOTTOM). Booleans are integers (0 or 1), as in the VM
+  struct value {
+    enum : unsigned char {TOP, CONST, BOTTOM} state = TOP;
+    enum : unsigned char {INT, FLOAT, CHAR} kind = INT;
+    int32_t i = 0;
+    float f = 0;
+    operand ch;
+
+    static value bottom() { value v; v.state = BOTTOM; return v; }
+    static value integer(int32_t n) { value v; v.state = CONST; v.kind = INT; v.i = n; return v; }
+    static value floating(float x) { value v; v.state = CONST; v.kind = FLOAT; v.f = x; return v; }
+    static value character(const operand &c) { value v; v.state = CONST; v.kind = CHAR; v.ch = c; return v; }
+
+    bool is_const() const { return state == CONST; }
+    bool operator==(const value &o) const {
+      if (state != o.state) return false;
+      if (state != CONST) return true;
+      if (kind != o.kind) return false;
+      if (kind == INT) return i == o.i;
+      if (kind == FLOAT) return memcmp(&f, &o.f, sizeof(f)) == 0;
+      return ch == o.ch;
+    }
+    bool operator!=(const value &o) const { return not (*this == o); }
+  };
+
+  value meet(const value &a, const value &b) {
+    if (a.state == value::TOP) return b;
+    if (b.state == value::TOP) return a;
+    if (a == b) return a;
+    return value::bottom();
+  }
+
+  bool same_bits(float a, float b) { return memcmp(&a, &b, sizeof(a)) == 0; }
+
+  /// value of a float literal, if the VM (strtof) and the LLVM IR
+  /// (double truncated to float) read the same number
+  bool parse_float(const string &s, float &f) {
+    f = strtof(s.c_str(), nullptr);
+    return same_bits(f, float(strtod(s.c_str(), nullptr)));
+  }
+
+  /// literal for a float (in the "123.456" form the VM reads): the
+  /// shortest one that is read back as f. There is none for the
+  /// infinities, the NaNs and the negative values (the VM does not
+  /// read negative float literals)
+  bool float_literal(float f, string &s) {
+    if (not isfinite(f) or signbit(f)) return false;
+    char buf[128];
+    for (int digits = 1; digits <= 60; ++digits) {
+      snprintf(buf, sizeof(buf), "%.*f", digits, double(f));
+      float back;
+      if (parse_float(buf, back) and same_bits(back, f)) {
+        s = buf;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// code of a character literal ('a', '\n', ...), or -1
+  int char_code(const string &s) {
+    if (s.size() == 3 and s[1] != '\\') return (unsigned char)s[1];
+    if (s.size() == 4 and s[1] == '\\') {
+      switch (s[2]) {
+      case 'n': return '\n';
+      case 't': return '\t';
+      case '\\': return '\\';
+      case '\'': return '\'';
+      }
+    }
+    return -1;
+  }
+
+  /// integer arithmetic as in the VM (wraps around at 32 bits)
+  int32_t wrap(int64_t n) { return int32_t(uint32_t(uint64_t(n))); }
+
+
+  ////////////////////////////////////////////////////////////////////
+  /// The propagation over one subroutine
+
+  class propagation {
+  public:
+    propagation(subroutine &sub);
+    /// propagate the values, then rewrite the subroutine. Returns
+    /// true if it changed
+    bool run();
+
+  private:
+    subroutine &sub;
+    const instructionList &insts;
+    flowgraph graph;
+    slots sl;
+    reaching_definitions rd;
+
+    /// definitions reaching each use: the ones of the argument k
+    /// (1 to 3) of the instruction at pc are chain[first[3*pc+k-1]]
+    /// to chain[first[3*pc+k]-1]
+    vector<uint32_t> first, chain;
+    /// instructions that use each definition
+    vector<vector<uint32_t>> users;
+
+    vector<value> values;
+    vector<bool> executable;
+    vector<flowgraph::blockId> blockWork;
+    vector<uint32_t> defWork;
+
+    void build_chains();
+    void mark_block(flowgraph::blockId b);
+    void visit(size_t pc);
+    value arg_value(size_t pc, unsigned k) const;
+    value evaluate(size_t pc) const;
+    flowgraph::blockId jump_target(const instruction &inst) const;
+  };
+
+  propagation::propagation(subroutine &s)
+    : sub(s), insts(s.get_instructions()), graph(s), sl(s), rd(graph, sl, s) {}
+
+  /// argument k (1 to 3) of an instruction
+  const operand &argument(const instruction &inst, unsigned k) {
+    return k == 1 ? inst.arg1 : (k == 2 ? inst.arg2 : inst.arg3);
+  }
+
+  /// def-use chains from the reaching definitions
+  void propagation::build_chains() {
+    first.assign(3 * insts.size() + 1, 0);
+    users.assign(rd.num_defs(), {});
+    operand uses[3];
+    for (flowgraph::blockId b = 0; b < graph.num_blocks(); ++b) {
+      const flowgraph::block &blk = graph.get_block(b);
+      bitvector reach = rd.in(b);
+      for (size_t pc = blk.begin; pc < blk.end; ++pc) {
+        const instruction &inst = insts[pc];
+        unsigned n = slots::get_uses(inst, uses);
+        bool defines = not slots::get_def(inst).empty();
+        for (unsigned k = 1; k <= 3; ++k) {
+          const operand &a = argument(inst, k);
+          bool used = false;
+          if (k > 1 or not defines)
+            for (unsigned u = 0; u < n; ++u) used = used or uses[u] == a;
+          if (used)
+            for (uint32_t d : rd.defs_of(sl.slot_of(a)))
+              if (reach.test(d)) {
+                chain.push_back(d);
+                if (users[d].empty() or users[d].back() != pc) users[d].push_back(pc);
+              }
+          first[3 * pc + k] = chain.size();
+        }
+        rd.step(pc, reach);
+      }
+    }
+  }
+
+  /// block reached by a jump (the exit for an unknown label)
+  flowgraph::blockId propagation::jump_target(const instruction &inst) const {
+    const operand &label = inst.oper == instruction::_FJUMP ? inst.arg2 : inst.arg1;
+    return graph.block_of(sub.get_label_pc(label));
+  }
+
+  void propagation::mark_block(flowgraph::blockId b) {
+    if (executable[b]) return;
+    executable[b] = true;
+    blockWork.push_back(b);
+  }
+
+  /// kind of the literals an instruction reads (the opcode gives it;
+  /// a literal of another kind is not folded). The comparisons read
+  /// integers or characters, and the code generator loads the
+  /// characters with a copy. Other instructions (stores, writes) give
+  /// no constant for a literal
+  bool literal_fits(instruction::Operation oper, operand::Kind kind) {
+    switch (oper) {
+    case instruction::_ILOAD:
+    case instruction::_ADD: case instruction::_SUB: case instruction::_MUL:
+    case instruction::_DIV: case instruction::_AND: case instruction::_OR:
+    case instruction::_NEG: case instruction::_NOT: case instruction::_FLOAT:
+    case instruction::_FJUMP:
+      return kind == operand::INT;
+    case instruction::_EQ: case instruction::_LT: case instruction::_LE:
+      return kind == operand::INT or kind == operand::CHAR;
+    case instruction::_FLOAD:
+    case instruction::_FADD: case instruction::_FSUB: case instruction::_FMUL:
+    case instruction::_FDIV: case instruction::_FEQ:  case instruction::_FLT:
+    case instruction::_FLE:  case instruction::_FNEG:
+      return kind == operand::FLOAT;
+    case instruction::_CHLOAD: case instruction::_LOAD:
+      return kind == operand::CHAR;
+    default:
+      return false;
+    }
+  }
+
+  /// value of the argument k of the instruction at pc
+  value propagation::arg_value(size_t pc, unsigned k) const {
+    const instruction &inst = insts[pc];
+    const operand &a = argument(inst, k);
+    float f;
+    switch (a.get_kind()) {
+    case operand::TEMP: case operand::NAME:
+      break;
+    case operand::INT: case operand::FLOAT: case operand::CHAR:
+      if (not literal_fits(inst.oper, a.get_kind())) return value::bottom();
+      if (a.get_kind() == operand::INT) return value::integer(int32_t(a.get_value()));
+      if (a.get_kind() == operand::CHAR) return value::character(a);
+      return parse_float(sub.get_spellings().str(a), f) ? value::floating(f) : value::bottom();
+    default:  // DIGITS are left as written
+      return value::bottom();
+    }
+    value v;
+    for (uint32_t c = first[3 * pc + k - 1]; c < first[3 * pc + k]; ++c) {
+      size_t dpc = rd.def_pc(chain[c]);
+      if (dpc == subroutine::NO_PC) return value::bottom();
+      if (executable[graph.block_of(dpc)]) v = meet(v, values[chain[c]]);
+    }
+    return v;
+  }
+
+  /// value computed by the instruction at pc
+  value propagation::evaluate(size_t pc) const {
+    const instruction &inst = insts[pc];
+    value a, b;
+    switch (inst.oper) {
+    case instruction::_LOAD: case instruction::_ILOAD:
+    case instruction::_CHLOAD: case instruction::_FLOAD:
+      return arg_value(pc, 2);
+    case instruction::_ADD: case instruction::_SUB: case instruction::_MUL:
+    case instruction::_DIV: case instruction::_EQ:  case instruction::_LT:
+    case instruction::_LE:  case instruction::_AND: case instruction::_OR:
+    case instruction::_FADD: case instruction::_FSUB: case instruction::_FMUL:
+    case instruction::_FDIV: case instruction::_FEQ:  case instruction::_FLT:
+    case instruction::_FLE:
+      a = arg_value(pc, 2);
+      b = arg_value(pc, 3);
+      break;
+    case instruction::_NEG: case instruction::_NOT:
+    case instruction::_FNEG: case instruction::_FLOAT:
+      a = arg_value(pc, 2);
+      b = value::integer(0);
+      break;
+    default:   // loads from memory, pops, reads
+      return value::bottom();
+    }
+    if (a.state == value::BOTTOM or b.state == value::BOTTOM) return value::bottom();
+    if (a.state == value::TOP or b.state == value::TOP) return value();
+
+    // characters are only compared
+    if (a.kind == value::CHAR or b.kind == value::CHAR) {
+      const spellings &words = sub.get_spellings();
+      int ca = a.kind == value::CHAR ? char_code(words.str(a.ch)) : -1;
+      int cb = b.kind == value::CHAR ? char_code(words.str(b.ch)) : -1;
+      if (ca < 0 or cb < 0) return value::bottom();
+      switch (inst.oper) {
+      case instruction::_EQ: return value::integer(ca == cb);
+      case instruction::_LT: return value::integer(ca < cb);
+      case instruction::_LE: return value::integer(ca <= cb);
+      default: return value::bottom();
+      }
+    }
+
+    bool isFloat = a.kind == value::FLOAT;
+    if (isFloat != (b.kind == value::FLOAT) and inst.oper != instruction::_FLOAT
+        and inst.oper != instruction::_FNEG)
+      return value::bottom();
+    int64_t x = a.i, y = b.i;
+    float fx = a.f, fy = b.f;
+    switch (inst.oper) {
+    case instruction::_ADD: return isFloat ? value::bottom() : value::integer(wrap(x + y));
+    case instruction::_SUB: return isFloat ? value::bottom() : value::integer(wrap(x - y));
+    case instruction::_MUL: return isFloat ? value::bottom() : value::integer(wrap(x * y));
+    case instruction::_DIV:
+      // the VM traps on these
+      if (isFloat or y == 0 or (x == INT_MIN and y == -1)) return value::bottom();
+      return value::integer(int32_t(x / y));
+    case instruction::_EQ:  return value::integer(isFloat ? fx == fy : x == y);
+    case instruction::_LT:  return isFloat ? value::bottom() : value::integer(x < y);
+    case instruction::_LE:  return isFloat ? value::bottom() : value::integer(x <= y);
+    case instruction::_AND: return isFloat ? value::bottom() : value::integer(x != 0 and y != 0);
+    case instruction::_OR:  return isFloat ? value::bottom() : value::integer(x != 0 or y != 0);
+    case instruction::_NEG: return isFloat ? value::bottom() : value::integer(wrap(-x));
+    case instruction::_NOT: return isFloat ? value::bottom() : value::integer(x == 0);
+    case instruction::_FLOAT:
+      return isFloat ? value::bottom() : value::floating(float(a.i));
+    case instruction::_FNEG: return isFloat ? value::floating(-fx) : value::bottom();
+    case instruction::_FADD: return isFloat ? value::floating(fx + fy) : value::bottom();
+    case instruction::_FSUB: return isFloat ? value::floating(fx - fy) : value::bottom();
+    case instruction::_FMUL: return isFloat ? value::floating(fx * fy) : value::bottom();
+    case instruction::_FDIV: return isFloat ? value::floating(fx / fy) : value::bottom();
+    case instruction::_FEQ: return isFloat ? value::integer(fx == fy) : value::bottom();
+    case instruction::_FLT: return isFloat ? value::integer(fx < fy) : value::bottom();
+    case instruction::_FLE: return isFloat ? value::integer(fx <= fy) : value::bottom();
+    default: return value::bottom();
+    }
+  }
+
+  /// evaluate the instruction at pc (in an executable block)
+  void propagation::visit(size_t pc) {
+    const instruction &inst = insts[pc];
+    if (inst.oper == instruction::_FJUMP) {
+      flowgraph::blockId b = graph.block_of(pc);
+      value cond = arg_value(pc, 1);
+      if (cond.state == value::TOP) return;
+      bool known = cond.is_const() and cond.kind == value::INT;
+      if (not known or cond.i == 0) mark_block(jump_target(inst));
+      if (not known or cond.i != 0) mark_block(b + 1);
+      return;
+    }
+    size_t d = rd.def_at(pc);
+    if (d == reaching_definitions::NO_DEF) return;
+    value v = meet(values[d], evaluate(pc));
+    if (v != values[d]) {
+      values[d] = v;
+      defWork.push_back(d);
+    }
+  }
+
+  /// instruction that loads the constant v into dst (false if there
+  /// is no literal for v). A new float literal is interned in words
+  bool constant_load(const operand &dst, const value &v, spellings &words,
+                     instruction &inst) {
+    string s;
+    switch (v.kind) {
+    case value::INT:
+      if (v.i == INT_MIN) return false;   // the VM can not read it
+      inst = instruction::ILOAD(dst, operand::integer(v.i));
+      return true;
+    case value::FLOAT:
+      if (not float_literal(v.f, s)) return false;
+      inst = instruction::FLOAD(dst, words.floating(s));
+      return true;
+    default:
+      inst = instruction::LOAD(dst, v.ch);
+      return true;
+    }
+  }
+
+  /// true if the instruction already loads a constant
+  bool is_constant_load(const instruction &inst) {
+    switch (inst.oper) {
+    case instruction::_ILOAD: case instruction::_FLOAD: case instruction::_CHLOAD:
+      return true;
+    case instruction::_LOAD:
+      return inst.arg2.get_kind() == operand::INT or inst.arg2.get_kind() == operand::FLOAT
+        or inst.arg2.get_kind() == operand::CHAR;
+    default:
+      return false;
+    }
+  }
+
+  bool propagation::run() {
+    if (insts.empty()) return false;
+    build_chains();
+    values.assign(rd.num_defs(), value());
+    executable.assign(graph.num_blocks(), false);
+
+    mark_block(graph.entry_block());
+    while (not blockWork.empty() or not defWork.empty()) {
+      while (not blockWork.empty()) {
+        flowgraph::blockId b = blockWork.back();
+        blockWork.pop_back();
+        const flowgraph::block &blk = graph.get_block(b);
+        for (size_t pc = blk.begin; pc < blk.end; ++pc) visit(pc);
+        if (blk.begin == blk.end or insts[blk.end - 1].oper != instruction::_FJUMP)
+          for (flowgraph::blockId s : blk.succs) mark_block(s);
+      }
+      while (not defWork.empty() and blockWork.empty()) {
+        uint32_t d = defWork.back();
+        defWork.pop_back();
+        for (uint32_t pc : users[d])
+          if (executable[graph.block_of(pc)]) visit(pc);
+      }
+    }
+
+    // rewrite the constants and the jumps with a known condition
+    bool changed = false;
+    vector<bool> removed(insts.size(), false);
+    bool anyRemoved = false;
+    for (flowgraph::blockId b = 0; b < graph.num_blocks(); ++b) {
+      if (not executable[b]) continue;
+      const flowgraph::block &blk = graph.get_block(b);
+      for (size_t pc = blk.begin; pc < blk.end; ++pc) {
+        const instruction &inst = insts[pc];
+        if (inst.oper == instruction::_FJUMP) {
+          value cond = arg_value(pc, 1);
+          if (not cond.is_const() or cond.kind != value::INT) continue;
+          if (cond.i == 0)
+            sub.set_instruction_at(pc, instruction(instruction::_UJUMP, inst.arg2));
+          else {
+            removed[pc] = true;
+            anyRemoved = true;
+          }
+          changed = true;
+          continue;
+        }
+        // only temporals are loaded with a literal, as the code
+        // generator does (the LLVM emitter stores floats in variables
+        // with no conversion)
+        size_t d = rd.def_at(pc);
+        if (d == reaching_definitions::NO_DEF or not values[d].is_const() or
+            inst.arg1.get_kind() != operand::TEMP or is_constant_load(inst))
+          continue;
+        instruction load(instruction::_NOOP);
+        if (constant_load(inst.arg1, values[d], sub.get_spellings(), load)) {
+          sub.set_instruction_at(pc, load);
+          changed = true;
+        }
+      }
+    }
+    if (anyRemoved) sub.remove_instructions(removed);
+
+    // the blocks behind the jumps that have been folded
+    if (changed) unreachable_code().run(sub);
+    return changed;
+  }
+
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'sccp'
+
+string sccp::get_name() const { return "sccp"; }
+
+bool sccp::run(subroutine &sub) {
+  propagation prop(sub);
+  return prop.run();
+}